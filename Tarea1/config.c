@@ -0,0 +1,163 @@
+#include "config.h"
+#include "radix.h"
+
+/*
+entrega la configuracion por defecto: B = BLOCK_SIZE, M = MEMORY_LIMIT, el
+backend por defecto de abrirArchivo y el ordenamiento por comparacion en memoria
+con un hilo
+*/
+ConfigOrden configPorDefecto(void) {
+    ConfigOrden cfg;
+    cfg.tamBloque = BLOCK_SIZE;
+    cfg.memoria = MEMORY_LIMIT;
+    cfg.backend = obtenerBackendPorDefecto();
+    cfg.estadisticas = NULL;
+    cfg.motor = MOTOR_COMPARACION;
+    cfg.hilos = 1;
+    cfg.aridadPorNivel = 1;
+    cfg.colocacionDirecta = 1;
+    cfg.limiteReloj = 0;
+    return cfg;
+}
+
+/*
+revisa que B y M tengan sentido para el backend elegido, y que haya al menos un hilo
+cfg: configuracion a revisar
+return: 0 si es valida, -1 si no
+*/
+int validarConfig(const ConfigOrden *cfg) {
+    if (cfg->tamBloque < ELEMENT_SIZE || cfg->tamBloque % ELEMENT_SIZE != 0) {
+        printf("Error: B = %zu debe ser multiplo de %zu bytes\n", cfg->tamBloque, ELEMENT_SIZE);
+        return -1;
+    }
+    if (cfg->backend == IO_DIRECTO && cfg->tamBloque % ALINEAMIENTO_IO != 0) {
+        printf("Error: con O_DIRECT B = %zu debe ser multiplo de %d bytes\n",
+               cfg->tamBloque, ALINEAMIENTO_IO);
+        return -1;
+    }
+    if (cfg->hilos < 1) {
+        printf("Error: se necesita al menos un hilo (se pidieron %d)\n", cfg->hilos);
+        return -1;
+    }
+    //M tiene que alcanzar al menos para el pool y unos pocos bloques de trabajo: los
+    //runs necesitan 4 bloques de buffers y algo mas para el heap
+    if (cfg->memoria < 4 * cfg->tamBloque || bloquesEnMemoriaConfig(cfg) < MINIMO_BLOQUES_TRABAJO) {
+        printf("Error: M = %zu es muy chico para B = %zu\n", cfg->memoria, cfg->tamBloque);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+valida la configuracion y deja el pool de bloques con su B y su parte de M
+debe llamarse sin archivos abiertos (o con el pool ya configurado igual)
+cfg: configuracion a aplicar
+return: 0 si exito, -1 si error
+*/
+int prepararConfig(const ConfigOrden *cfg) {
+    if (validarConfig(cfg) != 0) {
+        return -1;
+    }
+    if (cfg->backend != IO_MMAP && configurarPool(memoriaPoolConfig(cfg), cfg->tamBloque) != 0) {
+        printf("Error: no se pudo configurar el pool con B = %zu\n", cfg->tamBloque);
+        return -1;
+    }
+    return 0;
+}
+
+//opciones para abrir los archivos de un ordenamiento con esta configuracion
+OpcionesArchivo opcionesDeConfig(const ConfigOrden *cfg) {
+    OpcionesArchivo opciones;
+    opciones.backend = cfg->backend;
+    opciones.tamBloque = cfg->tamBloque;
+    opciones.estadisticas = cfg->estadisticas;
+    return opciones;
+}
+
+/*
+asegura que la configuracion tenga un contexto de I/O: si no tiene, se entrega una
+copia que cuenta en io (que se deja en 0); si ya tiene, se entrega la misma
+cfg: configuracion recibida
+copia: donde armar la copia si hace falta
+io: contexto propio para la copia
+return: configuracion a usar, siempre con contexto de I/O
+*/
+const ConfigOrden *configConEstadisticas(const ConfigOrden *cfg, ConfigOrden *copia, EstadisticasIO *io) {
+    if (cfg->estadisticas != NULL) {
+        return cfg;
+    }
+    estadisticasACero(io);
+    *copia = *cfg;
+    copia->estadisticas = io;
+    return copia;
+}
+
+//1 si cfg tiene limite de tiempo y el reloj real ya lo paso
+int limiteExcedido(const ConfigOrden *cfg) {
+    return cfg->limiteReloj != 0 && relojReal() > cfg->limiteReloj;
+}
+
+//segundos del reloj monotono: a diferencia de clock() cuenta el tiempo esperando
+//al disco y no suma la CPU de cada hilo
+double relojReal(void) {
+    struct timespec ahora;
+    clock_gettime(CLOCK_MONOTONIC, &ahora);
+    return (double)ahora.tv_sec + (double)ahora.tv_nsec / 1e9;
+}
+
+//segundos de reloj real desde 'inicio' (CLOCK_MONOTONIC)
+double segundosRealesDesde(const struct timespec *inicio) {
+    struct timespec ahora;
+    clock_gettime(CLOCK_MONOTONIC, &ahora);
+    return (double)(ahora.tv_sec - inicio->tv_sec) + (ahora.tv_nsec - inicio->tv_nsec) / 1e9;
+}
+
+//elementos por bloque (b = B / 8)
+size_t elementosPorBloqueConfig(const ConfigOrden *cfg) {
+    return cfg->tamBloque / ELEMENT_SIZE;
+}
+
+//parte de M reservada al pool de bloques
+size_t memoriaPoolConfig(const ConfigOrden *cfg) {
+    return cfg->memoria / FRACCION_POOL;
+}
+
+//elementos que caben en la memoria de trabajo (M sin el pool)
+size_t elementosEnMemoriaConfig(const ConfigOrden *cfg) {
+    return (cfg->memoria - memoriaPoolConfig(cfg)) / ELEMENT_SIZE;
+}
+
+//bloques de tamaño B que caben en la memoria de trabajo (M / B)
+size_t bloquesEnMemoriaConfig(const ConfigOrden *cfg) {
+    return (cfg->memoria - memoriaPoolConfig(cfg)) / cfg->tamBloque;
+}
+
+//limita un buffer de E/S a una fraccion de la memoria de trabajo (importa con M chico)
+size_t bloquesAcotadosConfig(const ConfigOrden *cfg, size_t bloques, size_t fraccion) {
+    size_t maximo = bloquesEnMemoriaConfig(cfg) / fraccion;
+    if (bloques > maximo) {
+        bloques = maximo;
+    }
+    return (bloques > 0) ? bloques : 1;
+}
+
+/*
+elementos de arreglo auxiliar que puede usar un caso base en memoria que ya tiene
+cargados numElementos: lo que queda de la memoria de trabajo, hasta numElementos. con
+radix sort se descuentan antes los histogramas de cada hilo
+cfg: configuracion del ordenamiento
+numElementos: elementos del arreglo a ordenar
+return: elementos del auxiliar, 0 si no queda memoria
+*/
+size_t auxiliarEnMemoriaConfig(const ConfigOrden *cfg, size_t numElementos) {
+    size_t elementosEnMemoria = elementosEnMemoriaConfig(cfg);
+    if (cfg->motor == MOTOR_RADIX) {
+        size_t histogramas = (size_t)cfg->hilos * MEMORIA_RADIX / ELEMENT_SIZE;
+        elementosEnMemoria = (elementosEnMemoria > histogramas) ? elementosEnMemoria - histogramas : 0;
+    }
+    if (elementosEnMemoria <= numElementos) {
+        return 0;
+    }
+    size_t tamAux = elementosEnMemoria - numElementos;
+    return (tamAux < numElementos) ? tamAux : numElementos;
+}
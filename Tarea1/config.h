@@ -0,0 +1,47 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "disco.h"
+#include <time.h>
+
+//ordenamiento que usan los casos base en memoria
+typedef enum {
+    MOTOR_COMPARACION, //el clasico de cada algoritmo (mergesort o quicksort)
+    MOTOR_RADIX        //radix sort LSD sobre las claves int64_t
+} MotorMemoria;
+
+//parametros del modelo de memoria externa con que corren los ordenamientos
+typedef struct {
+    size_t tamBloque; //B en bytes
+    size_t memoria;   //M en bytes
+    TipoIO backend;
+    EstadisticasIO *estadisticas; //contexto de I/O donde se cuentan los accesos, NULL si cada orden usa uno propio
+    MotorMemoria motor; //ordenamiento del caso base en memoria
+    int hilos;          //hilos para ordenar en memoria y para las fases externas del mergesort
+    int aridadPorNivel; //1: la aridad es el maximo de cada nivel y cada nivel usa solo la que necesita
+    int colocacionDirecta; //1: quicksort ordena cada particion directo en su tramo de la salida, 0: las concatena
+    double limiteReloj; //si no es 0, mergesort se abandona (return -1) cuando relojReal() lo pasa
+} ConfigOrden;
+
+#define REVISION_LIMITE (1 << 16) //elementos entre revisiones de limiteReloj
+#define MINIMO_BLOQUES_TRABAJO 8  //bloques de la memoria de trabajo (M sin el pool) que pide validarConfig
+
+//configuracion
+ConfigOrden configPorDefecto(void);
+int validarConfig(const ConfigOrden *cfg);
+int prepararConfig(const ConfigOrden *cfg);
+OpcionesArchivo opcionesDeConfig(const ConfigOrden *cfg);
+const ConfigOrden *configConEstadisticas(const ConfigOrden *cfg, ConfigOrden *copia, EstadisticasIO *io);
+int limiteExcedido(const ConfigOrden *cfg);
+double relojReal(void);
+double segundosRealesDesde(const struct timespec *inicio);
+
+//tamaños derivados de B y M
+size_t elementosPorBloqueConfig(const ConfigOrden *cfg);
+size_t memoriaPoolConfig(const ConfigOrden *cfg);
+size_t elementosEnMemoriaConfig(const ConfigOrden *cfg);
+size_t bloquesEnMemoriaConfig(const ConfigOrden *cfg);
+size_t bloquesAcotadosConfig(const ConfigOrden *cfg, size_t bloques, size_t fraccion);
+size_t auxiliarEnMemoriaConfig(const ConfigOrden *cfg, size_t numElementos);
+
+#endif
@@ -1,226 +1,2289 @@
+#define _GNU_SOURCE  //O_DIRECT
 #include "disco.h"
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <pthread.h>
 
-long long accesos = 0; //contador de accesos
+#define BLOQUE_LEIDO 1    //el bloque mapeado ya se conto como leido
+#define BLOQUE_ESCRITO 2  //el bloque mapeado fue modificado
+#define CRECIMIENTO_MAPA (COPIA_BLOQUES * BLOCK_SIZE / ELEMENT_SIZE)  //crecimiento minimo de un mapa en elementos
 
-//vuelve el contador a 0
+static EstadisticasIO estadisticasPorDefecto; //contexto de los archivos abiertos sin uno propio
+static TipoIO backendPorDefecto = IO_STDIO;
+
+//vuelve el contador global a 0
 void contadorACero(){
-    accesos = 0;
+    estadisticasACero(&estadisticasPorDefecto);
+}
+
+//entrega accesos registrados en el contexto global
+long long obtenerAccesos(){
+    return accesosTotales(&estadisticasPorDefecto);
+}
+
+//entrega el contexto global, el que usan los archivos abiertos sin contexto propio
+EstadisticasIO *estadisticasGlobales(void) {
+    return &estadisticasPorDefecto;
+}
+
+//deja en 0 todos los contadores de un contexto
+void estadisticasACero(EstadisticasIO *io) {
+    __atomic_store_n(&io->lecturas, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&io->escrituras, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&io->bytesLeidos, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&io->bytesEscritos, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&io->saltos, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&io->descargas, 0, __ATOMIC_RELAXED);
+}
+
+//copia los contadores de un contexto que otros hilos pueden estar actualizando
+void copiarEstadisticas(const EstadisticasIO *io, EstadisticasIO *copia) {
+    copia->lecturas = __atomic_load_n(&io->lecturas, __ATOMIC_RELAXED);
+    copia->escrituras = __atomic_load_n(&io->escrituras, __ATOMIC_RELAXED);
+    copia->bytesLeidos = __atomic_load_n(&io->bytesLeidos, __ATOMIC_RELAXED);
+    copia->bytesEscritos = __atomic_load_n(&io->bytesEscritos, __ATOMIC_RELAXED);
+    copia->saltos = __atomic_load_n(&io->saltos, __ATOMIC_RELAXED);
+    copia->descargas = __atomic_load_n(&io->descargas, __ATOMIC_RELAXED);
+}
+
+//diferencia = fin - inicio, para medir una operacion a partir de dos copias
+void restarEstadisticas(const EstadisticasIO *fin, const EstadisticasIO *inicio, EstadisticasIO *diferencia) {
+    diferencia->lecturas = fin->lecturas - inicio->lecturas;
+    diferencia->escrituras = fin->escrituras - inicio->escrituras;
+    diferencia->bytesLeidos = fin->bytesLeidos - inicio->bytesLeidos;
+    diferencia->bytesEscritos = fin->bytesEscritos - inicio->bytesEscritos;
+    diferencia->saltos = fin->saltos - inicio->saltos;
+    diferencia->descargas = fin->descargas - inicio->descargas;
+}
+
+//accesos a bloques (lecturas + escrituras), la medida que usan los experimentos
+long long accesosTotales(const EstadisticasIO *io) {
+    return __atomic_load_n(&io->lecturas, __ATOMIC_RELAXED) +
+           __atomic_load_n(&io->escrituras, __ATOMIC_RELAXED);
+}
+
+//suma las estadisticas io a destino (por ejemplo las de un hilo al total de la operacion)
+void sumarEstadisticas(EstadisticasIO *destino, const EstadisticasIO *io) {
+    __atomic_fetch_add(&destino->lecturas, io->lecturas, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&destino->escrituras, io->escrituras, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&destino->bytesLeidos, io->bytesLeidos, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&destino->bytesEscritos, io->bytesEscritos, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&destino->saltos, io->saltos, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&destino->descargas, io->descargas, __ATOMIC_RELAXED);
+}
+
+/*
+cuenta una transferencia de bloques en un contexto
+io: contexto de estadisticas
+escritura: 1 si es escritura, 0 si es lectura
+bloques: bloques transferidos
+bytes: bytes transferidos
+*/
+static void contarTransferencia(EstadisticasIO *io, int escritura, long long bloques, long long bytes) {
+    if (escritura) {
+        __atomic_fetch_add(&io->escrituras, bloques, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&io->bytesEscritos, bytes, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&io->lecturas, bloques, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&io->bytesLeidos, bytes, __ATOMIC_RELAXED);
+    }
+}
+
+/*
+cuenta un salto si el acceso a [primero, fin) no sigue al anterior del mismo flujo
+io: contexto de estadisticas
+cursor: bloque que sigue al ultimo acceso del flujo, se actualiza a fin
+*/
+static void contarSalto(EstadisticasIO *io, size_t *cursor, size_t primero, size_t fin) {
+    if (primero != *cursor) {
+        __atomic_fetch_add(&io->saltos, 1, __ATOMIC_RELAXED);
+    }
+    *cursor = fin;
+}
+
+//cuenta una descarga (fflush/msync) de un archivo
+static void contarDescarga(EstadisticasIO *io) {
+    __atomic_fetch_add(&io->descargas, 1, __ATOMIC_RELAXED);
+}
+
+//marco del pool: guarda un bloque de algun archivo abierto
+typedef struct {
+    int64_t *datos;
+    ArchivoBin *dueño; //archivo al que pertenece el bloque, NULL si el marco esta libre
+    long long idDueño;
+    size_t bloqIdx;
+    int sucio; //bloque modificado que aun no se escribe en disco
+    int referencia; //bit de referencia para el reemplazo CLOCK
+    int sigHash; //siguiente marco en la misma cubeta, -1 si no hay
+} Marco;
+
+//pool de bloques compartido por todos los archivos abiertos
+static Marco *marcos = NULL;
+static int64_t *memoriaPool = NULL;
+static int numMarcos = 0;
+static int *cubetas = NULL; //primer marco de cada cadena de la tabla hash
+static size_t numCubetas = 0;
+static int manecilla = 0; //posicion del reloj de CLOCK
+static long long siguienteId = 0;
+static int archivosAbiertos = 0;
+static size_t memoriaPedidaPool = 0;
+static size_t tamBloquePool = 0; //B de los marcos del pool
+
+//protege el pool (marcos, tabla hash, reloj, ids y archivos abiertos) cuando varios
+//hilos ordenan a la vez; un desalojo puede escribir el bloque de un archivo de otro
+//hilo, asi que tambien se toma mientras se usa el FILE de un archivo con bloques
+//en el pool. las funciones static suponen que quien llama ya lo tiene
+static pthread_mutex_t mutexPool = PTHREAD_MUTEX_INITIALIZER;
+
+//suma cambio a la cuenta de archivos abiertos
+static void contarArchivoAbierto(int cambio) {
+    pthread_mutex_lock(&mutexPool);
+    archivosAbiertos += cambio;
+    pthread_mutex_unlock(&mutexPool);
+}
+
+//cubeta de la tabla hash para el bloque bloqIdx del archivo id
+static size_t cubetaDe(long long id, size_t bloqIdx) {
+    uint64_t h = (uint64_t)id * 0x9E3779B97F4A7C15ULL ^ (uint64_t)bloqIdx * 0xC2B2AE3D27D4EB4FULL;
+    return (size_t)(h ^ (h >> 29)) & (numCubetas - 1);
+}
+
+/*
+reserva la memoria del pool de bloques, solo se puede hacer sin archivos abiertos
+(si ya esta configurado igual no se hace nada)
+memoria: bytes del pool (se usan memoria / tamBloque marcos, al menos 1)
+tamBloque: bytes de cada marco, los archivos que usan el pool deben tener este B
+return: 0 si exito, -1 si error
+*/
+static int configurarPoolInterno(size_t memoria, size_t tamBloque) {
+    if (marcos != NULL && memoria == memoriaPedidaPool && tamBloque == tamBloquePool) {
+        return 0;
+    }
+    if (archivosAbiertos > 0 || tamBloque < ELEMENT_SIZE || tamBloque % ELEMENT_SIZE != 0) {
+        return -1;
+    }
+
+    free(marcos);
+    free(memoriaPool);
+    free(cubetas);
+    marcos = NULL;
+    memoriaPool = NULL;
+    cubetas = NULL;
+
+    size_t elementosPool = tamBloque / ELEMENT_SIZE;
+    numMarcos = memoria / tamBloque;
+    if (numMarcos < 1) {
+        numMarcos = 1;
+    }
+
+    //tabla hash con al menos el doble de cubetas que marcos (potencia de 2)
+    numCubetas = 1;
+    while (numCubetas < 2 * (size_t)numMarcos) {
+        numCubetas <<= 1;
+    }
+
+    //los marcos se alinean para poder usarlos directamente con O_DIRECT
+    marcos = malloc(numMarcos * sizeof(Marco));
+    if (posix_memalign((void**)&memoriaPool, ALINEAMIENTO_IO, (size_t)numMarcos * tamBloque) != 0) {
+        memoriaPool = NULL;
+    }
+    cubetas = malloc(numCubetas * sizeof(int));
+    if (!marcos || !memoriaPool || !cubetas) {
+        free(marcos);
+        free(memoriaPool);
+        free(cubetas);
+        marcos = NULL;
+        memoriaPool = NULL;
+        cubetas = NULL;
+        numMarcos = 0;
+        return -1;
+    }
+    memoriaPedidaPool = memoria;
+    tamBloquePool = tamBloque;
+
+    for (int i = 0; i < numMarcos; i++) {
+        marcos[i].datos = memoriaPool + (size_t)i * elementosPool;
+        marcos[i].dueño = NULL;
+        marcos[i].idDueño = -1;
+        marcos[i].sucio = 0;
+        marcos[i].referencia = 0;
+        marcos[i].sigHash = -1;
+    }
+    for (size_t i = 0; i < numCubetas; i++) {
+        cubetas[i] = -1;
+    }
+    manecilla = 0;
+
+    return 0;
+}
+
+int configurarPool(size_t memoria, size_t tamBloque) {
+    pthread_mutex_lock(&mutexPool);
+    int resultado = configurarPoolInterno(memoria, tamBloque);
+    pthread_mutex_unlock(&mutexPool);
+    return resultado;
+}
+
+//entrega la cantidad de marcos del pool
+size_t obtenerMarcosPool(void) {
+    return numMarcos;
+}
+
+/*
+convierte una cantidad de bloques de BLOCK_SIZE a bloques de tamBloque que ocupen
+los mismos bytes, para que los trozos de copia no crezcan con B
+return: cantidad de bloques de tamBloque, al menos 1
+*/
+size_t bloquesDeTrozo(size_t tamBloque, size_t bloques) {
+    size_t cantidad = bloques * BLOCK_SIZE / tamBloque;
+    return (cantidad > 0) ? cantidad : 1;
+}
+
+//busca el marco que tiene el bloque bloqIdx del archivo, -1 si no esta en el pool
+static int buscarMarco(ArchivoBin *archivo, size_t bloqIdx) {
+    int m = cubetas[cubetaDe(archivo->id, bloqIdx)];
+    while (m != -1) {
+        if (marcos[m].idDueño == archivo->id && marcos[m].bloqIdx == bloqIdx) {
+            return m;
+        }
+        m = marcos[m].sigHash;
+    }
+    return -1;
+}
+
+static void insertarEnTabla(int m) {
+    size_t c = cubetaDe(marcos[m].idDueño, marcos[m].bloqIdx);
+    marcos[m].sigHash = cubetas[c];
+    cubetas[c] = m;
+}
+
+static void quitarDeTabla(int m) {
+    size_t c = cubetaDe(marcos[m].idDueño, marcos[m].bloqIdx);
+    int *enlace = &cubetas[c];
+    while (*enlace != -1) {
+        if (*enlace == m) {
+            *enlace = marcos[m].sigHash;
+            break;
+        }
+        enlace = &marcos[*enlace].sigHash;
+    }
+    marcos[m].sigHash = -1;
+}
+
+/*
+lee bloques consecutivos desde disco con el backend del archivo (stdio u O_DIRECT)
+archivo: estructura del archivo
+bloqIdx: primer bloque a leer
+cantidad: cantidad de bloques
+dst: destino (alineado a ALINEAMIENTO_IO si el backend es IO_DIRECTO)
+return: elementos leidos (menos que los pedidos al final del archivo), -1 si error
+*/
+static long leerBloquesDisco(ArchivoBin *archivo, size_t bloqIdx, size_t cantidad, int64_t *dst) {
+    if (archivo->backend == IO_DIRECTO) {
+        size_t bytes = cantidad * archivo->tamBloque;
+        size_t total = 0;
+        while (total < bytes) {
+            ssize_t r = pread(archivo->fd, (char*)dst + total, bytes - total,
+                              (off_t)(bloqIdx * archivo->tamBloque + total));
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+            if (r == 0) break;
+            total += r;
+        }
+        return (long)(total / ELEMENT_SIZE);
+    }
+
+    //posicionarse en el bloque
+    long offset = bloqIdx * archivo->tamBloque;
+    if (fseek(archivo->file, offset, SEEK_SET) != 0){
+        return -1;
+    }
+    size_t leidos = fread(dst, ELEMENT_SIZE, cantidad * archivo->elementosBloque, archivo->file);
+    if (ferror(archivo->file)) {
+        clearerr(archivo->file);
+        return -1;
+    }
+    return (long)leidos;
+}
+
+/*
+escribe bloques consecutivos en disco con el backend del archivo
+con stdio se escriben solo 'elementos' elementos; con O_DIRECT siempre se escriben
+bloques completos (el relleno se recorta con ftruncate al cerrar)
+archivo: estructura del archivo
+bloqIdx: primer bloque a escribir
+elementos: elementos validos desde el inicio del bloque
+src: datos (alineados a ALINEAMIENTO_IO si el backend es IO_DIRECTO)
+return: 0 si exito, -1 si error
+*/
+static int escribirBloquesDisco(ArchivoBin *archivo, size_t bloqIdx, size_t elementos, const int64_t *src) {
+    if (archivo->backend == IO_DIRECTO) {
+        size_t bytes = (elementos + archivo->elementosBloque - 1) / archivo->elementosBloque * archivo->tamBloque;
+        size_t total = 0;
+        while (total < bytes) {
+            ssize_t w = pwrite(archivo->fd, (const char*)src + total, bytes - total,
+                               (off_t)(bloqIdx * archivo->tamBloque + total));
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return -1;
+            }
+            total += w;
+        }
+        return 0;
+    }
+
+    //offset para posicionarse en el bloque
+    long offset = bloqIdx * archivo->tamBloque;
+    if (fseek(archivo->file, offset, SEEK_SET) != 0) {
+        return -1;
+    }
+    if (fwrite(src, ELEMENT_SIZE, elementos, archivo->file) != elementos) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+escribe en disco el bloque de un marco sucio
+solo se escriben los elementos que estan dentro del tamaño logico del archivo,
+asi el ultimo bloque no deja ceros de relleno al final del archivo
+m: indice del marco
+return: 0 si exito, -1 si error
+*/
+static int escribirMarco(int m) {
+    Marco *marco = &marcos[m];
+    if (!marco->sucio) {
+        return 0;
+    }
+
+    ArchivoBin *archivo = marco->dueño;
+    size_t inicio = marco->bloqIdx * archivo->elementosBloque;
+    size_t elementos = 0;
+    if (archivo->file_elementos > inicio) {
+        elementos = archivo->file_elementos - inicio;
+        if (elementos > archivo->elementosBloque) {
+            elementos = archivo->elementosBloque;
+        }
+    }
+
+    if (elementos > 0) {
+        int resultado = escribirBloquesDisco(archivo, marco->bloqIdx, elementos, marco->datos);
+        //con O_DIRECT siempre se escribe el bloque completo
+        size_t bytes = (archivo->backend == IO_DIRECTO) ? archivo->tamBloque : elementos * ELEMENT_SIZE;
+        contarTransferencia(archivo->estadisticas, 1, 1, bytes);
+        contarSalto(archivo->estadisticas, &archivo->siguienteBloque, marco->bloqIdx, marco->bloqIdx + 1);
+
+        if (resultado != 0) {
+            return -1;
+        }
+    }
+
+    marco->sucio = 0;
+    return 0;
+}
+
+//deja libre un marco, escribiendolo antes si esta sucio
+static int desalojarMarco(int m) {
+    if (marcos[m].dueño == NULL) {
+        return 0;
+    }
+    if (escribirMarco(m) != 0) {
+        return -1;
+    }
+    quitarDeTabla(m);
+    marcos[m].dueño = NULL;
+    marcos[m].idDueño = -1;
+    marcos[m].referencia = 0;
+    return 0;
+}
+
+/*
+elige un marco para un bloque nuevo con el algoritmo CLOCK:
+los marcos usados recientemente tienen una segunda oportunidad
+return: indice del marco libre, -1 si error
+*/
+static int elegirVictima(void) {
+    while (1) {
+        int m = manecilla;
+        manecilla = (manecilla + 1) % numMarcos;
+
+        if (marcos[m].dueño == NULL) {
+            return m;
+        }
+        if (marcos[m].referencia) {
+            marcos[m].referencia = 0;
+            continue;
+        }
+        if (desalojarMarco(m) != 0) {
+            return -1;
+        }
+        return m;
+    }
+}
+
+static int compararMarcosPorBloque(const void *a, const void *b) {
+    size_t ba = marcos[*(const int*)a].bloqIdx;
+    size_t bb = marcos[*(const int*)b].bloqIdx;
+    return (ba > bb) - (ba < bb);
+}
+
+/*
+escribe y libera todos los marcos de un archivo, en orden de bloque para que
+la escritura sea secuencial
+archivo: estructura del archivo
+return: 0 si exito, -1 si error
+*/
+static int liberarMarcosArchivo(ArchivoBin *archivo) {
+    int *propios = malloc(numMarcos * sizeof(int));
+    if (!propios) {
+        return -1;
+    }
+
+    int cantidad = 0;
+    for (int i = 0; i < numMarcos; i++) {
+        if (marcos[i].dueño == archivo && marcos[i].idDueño == archivo->id) {
+            propios[cantidad++] = i;
+        }
+    }
+    qsort(propios, cantidad, sizeof(int), compararMarcosPorBloque);
+
+    int resultado = 0;
+    for (int i = 0; i < cantidad; i++) {
+        if (desalojarMarco(propios[i]) != 0) {
+            resultado = -1;
+        }
+    }
+
+    free(propios);
+    archivo->marco = -1;
+    archivo->bloqActual = SIZE_MAX;
+    return resultado;
+}
+
+/*
+registra que se tocaron los bloques [primero, ultimo] de un archivo mapeado
+cada bloque cuenta un acceso de lectura la primera vez que se lee (como un fallo
+de pagina), las escrituras se cuentan al cerrar el archivo
+archivo: estructura del archivo
+primero, ultimo: rango de bloques tocados
+escritura: 1 si los bloques se modifican
+*/
+static void tocarBloquesMapa(ArchivoBin *archivo, size_t primero, size_t ultimo, int escritura) {
+    for (size_t b = primero; b <= ultimo && b < archivo->numEstados; b++) {
+        unsigned char estado = archivo->estadoBloques[b];
+        if (escritura) {
+            estado |= BLOQUE_ESCRITO;
+        } else if (estado == 0) {
+            estado = BLOQUE_LEIDO;
+            contarTransferencia(archivo->estadisticas, 0, 1, archivo->tamBloque);
+            contarSalto(archivo->estadisticas, &archivo->siguienteBloque, b, b + 1);
+        }
+        archivo->estadoBloques[b] = estado;
+    }
+}
+
+/*
+asegura que el mapa de un archivo cubra al menos minElementos, agrandando el
+archivo con ftruncate y volviendo a mapearlo
+archivo: estructura del archivo
+minElementos: cantidad de elementos que deben quedar mapeados
+return: 0 si exito, -1 si error
+*/
+static int asegurarCapacidadMapa(ArchivoBin *archivo, size_t minElementos) {
+    if (minElementos <= archivo->capacidad) {
+        return 0;
+    }
+    if (!archivo->escritura) {
+        return -1;
+    }
+
+    //crecer al menos al doble para no remapear en cada bloque
+    size_t nuevaCapacidad = archivo->capacidad * 2;
+    if (nuevaCapacidad < archivo->capacidad + CRECIMIENTO_MAPA) {
+        nuevaCapacidad = archivo->capacidad + CRECIMIENTO_MAPA;
+    }
+    if (nuevaCapacidad < minElementos) {
+        nuevaCapacidad = minElementos;
+    }
+    nuevaCapacidad = (nuevaCapacidad + archivo->elementosBloque - 1) / archivo->elementosBloque * archivo->elementosBloque;
+
+    if (ftruncate(archivo->fd, (off_t)(nuevaCapacidad * ELEMENT_SIZE)) != 0) {
+        return -1;
+    }
+    if (archivo->mapa) {
+        munmap(archivo->mapa, archivo->capacidad * ELEMENT_SIZE);
+        archivo->mapa = NULL;
+    }
+    void *mapa = mmap(NULL, nuevaCapacidad * ELEMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, archivo->fd, 0);
+    if (mapa == MAP_FAILED) {
+        archivo->capacidad = 0;
+        return -1;
+    }
+    archivo->mapa = mapa;
+    archivo->capacidad = nuevaCapacidad;
+
+    //estado por bloque para el conteo de accesos
+    size_t bloques = nuevaCapacidad / archivo->elementosBloque;
+    unsigned char *estados = realloc(archivo->estadoBloques, bloques);
+    if (!estados) {
+        return -1;
+    }
+    memset(estados + archivo->numEstados, 0, bloques - archivo->numEstados);
+    archivo->estadoBloques = estados;
+    archivo->numEstados = bloques;
+
+    return 0;
+}
+
+//traduce un modo de fopen ("rb", "wb", ...) a flags de open
+static int flagsDeModo(const char *modo) {
+    if (modo[0] == 'r') {
+        return (strchr(modo, '+') != NULL) ? O_RDWR : O_RDONLY;
+    } else if (modo[0] == 'a') {
+        return O_RDWR | O_CREAT;
+    }
+    return O_RDWR | O_CREAT | O_TRUNC;
+}
+
+//abre un archivo con el backend IO_MMAP
+static int abrirArchivoMapa(ArchivoBin *archivo, const char *filename, const char *modo) {
+    int flags = flagsDeModo(modo);
+
+    archivo->fd = open(filename, flags, 0644);
+    if (archivo->fd < 0) {
+        return -1;
+    }
+    archivo->escritura = (flags & O_RDWR) != 0;
+    archivo->file_elementos = (modo[0] == 'w') ? 0 : obtenerTamañoArchivo(filename);
+
+    //mapear el contenido actual, el mapa crece despues al escribir
+    if (archivo->file_elementos > 0) {
+        size_t bloques = (archivo->file_elementos + archivo->elementosBloque - 1) / archivo->elementosBloque;
+        int proteccion = archivo->escritura ? (PROT_READ | PROT_WRITE) : PROT_READ;
+        void *mapa = mmap(NULL, archivo->file_elementos * ELEMENT_SIZE, proteccion, MAP_SHARED, archivo->fd, 0);
+        archivo->estadoBloques = calloc(bloques, 1);
+        if (mapa == MAP_FAILED || !archivo->estadoBloques) {
+            if (mapa != MAP_FAILED) {
+                munmap(mapa, archivo->file_elementos * ELEMENT_SIZE);
+            }
+            free(archivo->estadoBloques);
+            archivo->estadoBloques = NULL;
+            close(archivo->fd);
+            return -1;
+        }
+        archivo->mapa = mapa;
+        archivo->capacidad = archivo->file_elementos;
+        archivo->numEstados = bloques;
+    }
+
+    return 0;
+}
+
+//sincroniza y cierra un archivo con el backend IO_MMAP
+static void cerrarArchivoMapa(ArchivoBin *archivo) {
+    //cada bloque modificado cuenta una escritura al bajar a disco
+    for (size_t b = 0; b < archivo->numEstados; b++) {
+        if (archivo->estadoBloques[b] & BLOQUE_ESCRITO) {
+            contarTransferencia(archivo->estadisticas, 1, 1, archivo->tamBloque);
+            contarSalto(archivo->estadisticas, &archivo->siguienteBloque, b, b + 1);
+        }
+    }
+
+    if (archivo->mapa) {
+        if (archivo->escritura) {
+            msync(archivo->mapa, archivo->capacidad * ELEMENT_SIZE, MS_SYNC);
+            contarDescarga(archivo->estadisticas);
+        }
+        munmap(archivo->mapa, archivo->capacidad * ELEMENT_SIZE);
+    }
+    //quitar lo que sobro de la ultima ampliacion del mapa
+    if (archivo->escritura) {
+        if (ftruncate(archivo->fd, (off_t)(archivo->file_elementos * ELEMENT_SIZE)) != 0) {
+            perror("ftruncate");
+        }
+    }
+    close(archivo->fd);
+
+    free(archivo->estadoBloques);
+    archivo->estadoBloques = NULL;
+    archivo->numEstados = 0;
+    archivo->mapa = NULL;
+    archivo->capacidad = 0;
+    archivo->fd = -1;
+}
+
+/*
+abre un archivo con el backend IO_DIRECTO (O_DIRECT, sin page cache)
+si el sistema de archivos no soporta O_DIRECT se avisa y se usa I/O normal,
+pero igual con bloques alineados
+*/
+static int abrirArchivoDirecto(ArchivoBin *archivo, const char *filename, const char *modo) {
+    int flags = flagsDeModo(modo);
+    //el pool puede tener que releer bloques ya escritos
+    if ((flags & O_ACCMODE) == O_WRONLY) {
+        flags = (flags & ~O_ACCMODE) | O_RDWR;
+    }
+
+#ifdef O_DIRECT
+    archivo->fd = open(filename, flags | O_DIRECT, 0644);
+    if (archivo->fd < 0 && errno == EINVAL) {
+        static int avisado = 0;
+        if (!avisado) {
+            printf("Aviso: O_DIRECT no soportado para %s, se usa I/O con cache\n", filename);
+            avisado = 1;
+        }
+        archivo->fd = open(filename, flags, 0644);
+    }
+#else
+    archivo->fd = open(filename, flags, 0644);
+#ifdef F_NOCACHE
+    if (archivo->fd >= 0) {
+        fcntl(archivo->fd, F_NOCACHE, 1);  //equivalente en macOS
+    }
+#endif
+#endif
+    if (archivo->fd < 0) {
+        return -1;
+    }
+
+    archivo->file_elementos = (modo[0] == 'w') ? 0 : obtenerTamañoArchivo(filename);
+    return 0;
+}
+
+//trae a un buffer alineado los bloques que cubren [pos, pos+n) y copia esa parte a dst
+static int leerRangoDirecto(ArchivoBin *archivo, size_t pos, size_t n, int64_t *dst) {
+    size_t bloquesTrozo = bloquesDeTrozo(archivo->tamBloque, COPIA_BLOQUES);
+    int64_t *trozo;
+    if (posix_memalign((void**)&trozo, ALINEAMIENTO_IO, bloquesTrozo * archivo->tamBloque) != 0) {
+        return -1;
+    }
+
+    size_t ultimoBloque = (pos + n - 1) / archivo->elementosBloque;
+    size_t bloque = pos / archivo->elementosBloque;
+    while (bloque <= ultimoBloque) {
+        size_t cantidad = ultimoBloque - bloque + 1;
+        if (cantidad > bloquesTrozo) {
+            cantidad = bloquesTrozo;
+        }
+        long leidos = leerBloquesDisco(archivo, bloque, cantidad, trozo);
+        if (leidos < 0) {
+            free(trozo);
+            return -1;
+        }
+        memset(trozo + leidos, 0, (cantidad * archivo->elementosBloque - leidos) * ELEMENT_SIZE);
+
+        //parte del rango pedido que cae en este trozo
+        size_t inicioTrozo = bloque * archivo->elementosBloque;
+        size_t desde = (pos > inicioTrozo) ? pos : inicioTrozo;
+        size_t hasta = inicioTrozo + cantidad * archivo->elementosBloque;
+        if (hasta > pos + n) {
+            hasta = pos + n;
+        }
+        memcpy(dst + (desde - pos), trozo + (desde - inicioTrozo), (hasta - desde) * ELEMENT_SIZE);
+
+        bloque += cantidad;
+    }
+
+    free(trozo);
+    return 0;
+}
+
+/*
+escribe [pos, pos+n) por trozos alineados; los bloques de los bordes que quedan
+a medias se leen antes para no pisar los elementos vecinos
+*/
+static int escribirRangoDirecto(ArchivoBin *archivo, size_t pos, size_t n, const int64_t *src) {
+    size_t bloquesTrozo = bloquesDeTrozo(archivo->tamBloque, COPIA_BLOQUES);
+    int64_t *trozo;
+    if (posix_memalign((void**)&trozo, ALINEAMIENTO_IO, bloquesTrozo * archivo->tamBloque) != 0) {
+        return -1;
+    }
+
+    size_t ultimoBloque = (pos + n - 1) / archivo->elementosBloque;
+    size_t bloque = pos / archivo->elementosBloque;
+    while (bloque <= ultimoBloque) {
+        size_t cantidad = ultimoBloque - bloque + 1;
+        if (cantidad > bloquesTrozo) {
+            cantidad = bloquesTrozo;
+        }
+        size_t inicioTrozo = bloque * archivo->elementosBloque;
+        size_t finTrozo = inicioTrozo + cantidad * archivo->elementosBloque;
+        size_t desde = (pos > inicioTrozo) ? pos : inicioTrozo;
+        size_t hasta = (finTrozo > pos + n) ? pos + n : finTrozo;
+
+        //bordes incompletos: partir del contenido actual del disco
+        memset(trozo, 0, cantidad * archivo->tamBloque);
+        if (desde > inicioTrozo && inicioTrozo < archivo->file_elementos) {
+            if (leerBloquesDisco(archivo, bloque, 1, trozo) < 0) {
+                free(trozo);
+                return -1;
+            }
+        }
+        size_t ultimoDelTrozo = bloque + cantidad - 1;
+        if (hasta < finTrozo && ultimoDelTrozo * archivo->elementosBloque < archivo->file_elementos &&
+            (ultimoDelTrozo != bloque || desde == inicioTrozo)) {
+            if (leerBloquesDisco(archivo, ultimoDelTrozo, 1,
+                                 trozo + (ultimoDelTrozo - bloque) * archivo->elementosBloque) < 0) {
+                free(trozo);
+                return -1;
+            }
+        }
+
+        memcpy(trozo + (desde - inicioTrozo), src + (desde - pos), (hasta - desde) * ELEMENT_SIZE);
+
+        //elementos validos del trozo: hasta lo escrito o hasta el final logico del archivo
+        size_t finValido = hasta;
+        if (archivo->file_elementos > finValido) {
+            finValido = (archivo->file_elementos < finTrozo) ? archivo->file_elementos : finTrozo;
+        }
+        if (escribirBloquesDisco(archivo, bloque, finValido - inicioTrozo, trozo) != 0) {
+            free(trozo);
+            return -1;
+        }
+
+        bloque += cantidad;
+    }
+
+    free(trozo);
+    return 0;
+}
+
+/*
+lee bloque tamaño B del archivo binario a traves del pool
+archivo: estructura del archivo
+bloqueIdx: indice o numero del bloque a leer
+return: 0 si exito -1 si error
+*/
+static int leerBloqueInterno(ArchivoBin *archivo, size_t bloqIdx){
+    assert(archivo != NULL);
+
+    //archivo mapeado: el bloque es directamente una parte del mapa
+    if (archivo->backend == IO_MMAP) {
+        if (archivo->escritura) {
+            if (asegurarCapacidadMapa(archivo, (bloqIdx + 1) * archivo->elementosBloque) != 0) {
+                return -1;
+            }
+        } else if (bloqIdx * archivo->elementosBloque >= archivo->capacidad) {
+            return -1;
+        }
+        if (archivo->bloqActual != bloqIdx) {
+            tocarBloquesMapa(archivo, bloqIdx, bloqIdx, 0);
+            archivo->bloqActual = bloqIdx;
+        }
+        archivo->buffer = archivo->mapa + bloqIdx * archivo->elementosBloque;
+        return 0;
+    }
+
+    assert(archivo->file != NULL || archivo->fd >= 0);
+
+    //si el bloque ya esta cargado (y su marco no fue reemplazado) no se hace nada
+    if (archivo->bloqActual == bloqIdx && archivo->marco >= 0 &&
+        marcos[archivo->marco].idDueño == archivo->id &&
+        marcos[archivo->marco].bloqIdx == bloqIdx){
+        marcos[archivo->marco].referencia = 1;
+        return 0;
+    }
+
+    //buscar el bloque en el pool antes de ir a disco
+    int m = buscarMarco(archivo, bloqIdx);
+    if (m < 0) {
+        m = elegirVictima();
+        if (m < 0) {
+            return -1;
+        }
+
+        //solo se lee de disco si el bloque tiene datos, si no se parte con ceros
+        size_t elementosLeidos = 0;
+        if (bloqIdx * archivo->elementosBloque < archivo->file_elementos) {
+            //leer bloque tamaño B
+            long leidos = leerBloquesDisco(archivo, bloqIdx, 1, marcos[m].datos);
+            if (leidos < 0) {
+                return -1;
+            }
+            contarTransferencia(archivo->estadisticas, 0, 1, leidos * ELEMENT_SIZE);
+            contarSalto(archivo->estadisticas, &archivo->siguienteBloque, bloqIdx, bloqIdx + 1);
+            elementosLeidos = (size_t)leidos;
+            //con O_DIRECT puede venir relleno despues del final logico
+            if (bloqIdx * archivo->elementosBloque + elementosLeidos > archivo->file_elementos) {
+                elementosLeidos = archivo->file_elementos - bloqIdx * archivo->elementosBloque;
+            }
+        }
+
+        //luego de leer el bloque se rellena con ceros
+        if (elementosLeidos < archivo->elementosBloque){
+            memset(marcos[m].datos + elementosLeidos, 0, (archivo->elementosBloque - elementosLeidos) * ELEMENT_SIZE);
+        }
+
+        marcos[m].dueño = archivo;
+        marcos[m].idDueño = archivo->id;
+        marcos[m].bloqIdx = bloqIdx;
+        marcos[m].sucio = 0;
+        insertarEnTabla(m);
+    }
+
+    marcos[m].referencia = 1;
+    archivo->marco = m;
+    archivo->buffer = marcos[m].datos;
+    archivo->bloqActual = bloqIdx;
+
+    return 0;
+}
+
+//el buffer que deja leerBloque apunta a un marco del pool: con varios hilos solo
+//es valido hasta la siguiente operacion de otro hilo sobre el pool
+int leerBloque(ArchivoBin *archivo, size_t bloqIdx) {
+    if (archivo->backend == IO_MMAP) {
+        return leerBloqueInterno(archivo, bloqIdx);
+    }
+    pthread_mutex_lock(&mutexPool);
+    int resultado = leerBloqueInterno(archivo, bloqIdx);
+    pthread_mutex_unlock(&mutexPool);
+    return resultado;
+}
+
+/*
+escribe en disco el bloque actual del archivo si fue modificado
+(normalmente el pool lo escribe al reemplazarlo o al cerrar el archivo)
+archivo: estructura del archivo
+return: 0 si exito, -1 si error 
+*/
+int escribirBloque(ArchivoBin *archivo){
+    assert(archivo != NULL);
+
+    if (archivo->backend == IO_MMAP) {
+        return 0;  //los bloques mapeados se sincronizan al cerrar
+    }
+
+    assert(archivo->file != NULL || archivo->fd >= 0);
+
+    pthread_mutex_lock(&mutexPool);
+    int resultado = 0;
+    //si el bloque ya no esta en el pool, se escribio al reemplazarlo
+    if (archivo->marco >= 0 && marcos[archivo->marco].idDueño == archivo->id) {
+        resultado = escribirMarco(archivo->marco);
+    }
+    pthread_mutex_unlock(&mutexPool);
+    return resultado;
+}
+
+
+/*
+convierte bloque binario en arreglo en memoria principal
+archivo: estructura del archivo
+bloqIdx: indice del bloque
+return: 0 si exito, -1 si error
+ */
+int cargarEnMemoria(ArchivoBin *archivo, size_t bloqIdx){
+     return leerBloque(archivo, bloqIdx);
+}
+
+/*
+abre un archivo binario con el modo especificado y el backend por defecto
+archivo: estructura del archivo
+filename: nombre del archivo
+modo: modo de apertura ("rb", "wb", ...)
+return 0 si exito, -1 si error
+*/
+int abrirArchivo(ArchivoBin *archivo, const char *filename, const char *modo) {
+    return abrirArchivoCon(archivo, filename, modo, NULL);
+}
+
+/*
+abre un archivo binario con el modo y las opciones especificadas
+archivo: estructura del archivo
+filename: nombre del archivo
+modo: modo de apertura ("rb", "wb", ...)
+opciones: backend, tamaño de bloque y contexto de estadisticas, NULL para usar el
+backend por defecto, BLOCK_SIZE y el contexto global
+return 0 si exito, -1 si error
+*/
+int abrirArchivoCon(ArchivoBin *archivo, const char *filename, const char *modo,
+                    const OpcionesArchivo *opciones) {
+    assert(archivo != NULL && filename != NULL && modo != NULL);
+
+    TipoIO backend = opciones ? opciones->backend : backendPorDefecto;
+    size_t tamBloque = (opciones && opciones->tamBloque > 0) ? opciones->tamBloque : BLOCK_SIZE;
+    if (tamBloque % ELEMENT_SIZE != 0 || (backend == IO_DIRECTO && tamBloque % ALINEAMIENTO_IO != 0)) {
+        printf("Error: tamaño de bloque %zu no valido para este backend\n", tamBloque);
+        return -1;
+    }
+
+    //el pool se crea con el primer archivo abierto, y se rehace con otro B
+    //si no queda ningun archivo usandolo
+    pthread_mutex_lock(&mutexPool);
+    if (backend != IO_MMAP && (marcos == NULL || tamBloque != tamBloquePool)) {
+        size_t memoria = (marcos == NULL) ? POOL_MEMORY : memoriaPedidaPool;
+        if (configurarPoolInterno(memoria, tamBloque) != 0) {
+            printf("Error: el pool de bloques esta en uso con B = %zu\n", tamBloquePool);
+            pthread_mutex_unlock(&mutexPool);
+            return -1;
+        }
+    }
+    archivo->id = siguienteId++;
+    pthread_mutex_unlock(&mutexPool);
+    
+    //copiar nombre del archivo
+    strncpy(archivo->filename, filename, sizeof(archivo->filename) - 1);
+    archivo->filename[sizeof(archivo->filename) - 1] = '\0';
+
+    //inicializar estructura, el buffer se asigna al cargar un bloque
+    archivo->backend = backend;
+    archivo->file = NULL;
+    archivo->buffer = NULL;
+    archivo->tamBloque = tamBloque;
+    archivo->elementosBloque = tamBloque / ELEMENT_SIZE;
+    archivo->tamañoBuffer = archivo->elementosBloque;
+    archivo->estadisticas = (opciones && opciones->estadisticas) ? opciones->estadisticas : &estadisticasPorDefecto;
+    archivo->siguienteBloque = 0;
+    archivo->bloqActual = SIZE_MAX;  //indica que no hay bloque cargado
+    archivo->marco = -1;
+    archivo->fd = -1;
+    archivo->mapa = NULL;
+    archivo->capacidad = 0;
+    archivo->estadoBloques = NULL;
+    archivo->numEstados = 0;
+    archivo->escritura = (modo[0] != 'r' || strchr(modo, '+') != NULL);
+    archivo->desplazamiento = 0;
+    archivo->largoVista = SIZE_MAX;
+
+    if (archivo->backend == IO_MMAP) {
+        if (abrirArchivoMapa(archivo, filename, modo) != 0) {
+            return -1;
+        }
+        contarArchivoAbierto(1);
+        return 0;
+    }
+
+    if (archivo->backend == IO_DIRECTO) {
+        if (abrirArchivoDirecto(archivo, filename, modo) != 0) {
+            return -1;
+        }
+        contarArchivoAbierto(1);
+        return 0;
+    }
+
+    //el pool puede tener que releer bloques ya escritos, por eso
+    //los modos de escritura se abren tambien para lectura ("wb" -> "w+b")
+    char modoReal[8];
+    if (strchr(modo, '+') == NULL && strlen(modo) < sizeof(modoReal) - 1) {
+        snprintf(modoReal, sizeof(modoReal), "%c+%s", modo[0], modo + 1);
+    } else {
+        strncpy(modoReal, modo, sizeof(modoReal) - 1);
+        modoReal[sizeof(modoReal) - 1] = '\0';
+    }
+    
+    //abrir archivo con el modo especificado
+    archivo->file = fopen(filename, modo[0] == 'r' ? modo : modoReal);
+    if (!archivo->file) {
+        return -1;
+    }
+    
+    contarArchivoAbierto(1);
+    
+    //calcular tamaño del archivo si es para lectura
+    if (strchr(modo, 'r') != NULL) {
+        archivo->file_elementos = obtenerTamañoArchivo(filename);
+    } else {
+        archivo->file_elementos = 0;
+    }
+    
+    return 0;
+}
+
+/*
+abre una vista de [inicio, inicio + numElementos) de un archivo existente: es un
+ArchivoBin normal (con su pool, backend y estadisticas) cuyas posiciones se corren en
+inicio, asi un ordenamiento puede leer o escribir un tramo de otro archivo sin
+copiarlo a uno propio. solo se abre con "rb" o "r+b", porque "wb" truncaria el archivo
+completo. dos vistas que comparten un bloque no se deben escribir a la vez
+vista: estructura del archivo
+filename: nombre del archivo completo
+modo: "rb" o "r+b"
+inicio: primer elemento de la vista en el archivo completo
+numElementos: largo de la vista
+opciones: como en abrirArchivoCon
+toda posicion que se use con la vista es relativa a inicio y debe quedar en
+[0, numElementos]: las lecturas, escrituras y lectores o escritores que salgan
+de ese rango fallan con -1 en vez de tocar el resto del archivo
+return 0 si exito, -1 si error
+*/
+int abrirVista(ArchivoBin *vista, const char *filename, const char *modo, size_t inicio, size_t numElementos,
+               const OpcionesArchivo *opciones) {
+    if (modo[0] != 'r') {
+        printf("Error: una vista se abre con \"rb\" o \"r+b\", no con \"%s\"\n", modo);
+        return -1;
+    }
+    if (abrirArchivoCon(vista, filename, modo, opciones) != 0) {
+        return -1;
+    }
+    vista->desplazamiento = inicio;
+    vista->largoVista = numElementos;
+    return 0;
+}
+
+//elementos que se pueden leer del archivo (o de la vista, si es una)
+size_t elementosArchivo(const ArchivoBin *archivo) {
+    size_t despues = (archivo->file_elementos > archivo->desplazamiento) ?
+                     archivo->file_elementos - archivo->desplazamiento : 0;
+    return (despues < archivo->largoVista) ? despues : archivo->largoVista;
+}
+
+//revisa que los n elementos desde pos queden dentro de la vista (un archivo completo
+//no tiene limite), 1 si quedan dentro
+static int dentroDeVista(const ArchivoBin *archivo, size_t pos, size_t n) {
+    if (pos <= archivo->largoVista && n <= archivo->largoVista - pos) {
+        return 1;
+    }
+    printf("Error: los elementos [%zu, %zu) salen de la vista de %zu elementos de %s\n",
+           pos, pos + n, archivo->largoVista, archivo->filename);
+    return 0;
+}
+
+//cambia el backend que usa abrirArchivo
+void establecerBackendPorDefecto(TipoIO backend) {
+    backendPorDefecto = backend;
+}
+
+//entrega el backend que usa abrirArchivo
+TipoIO obtenerBackendPorDefecto(void) {
+    return backendPorDefecto;
+}
+
+/*
+cierra un archivo y libera todos los recursos
+archivo: estructura del archivo a cerrar
+*/
+void cerrarArchivo(ArchivoBin *archivo) {
+    if (!archivo) return;
+
+    if (archivo->backend == IO_MMAP) {
+        if (archivo->fd >= 0) {
+            cerrarArchivoMapa(archivo);
+            contarArchivoAbierto(-1);
+        }
+        archivo->buffer = NULL;
+        return;
+    }
+    
+    //O_DIRECT escribe bloques completos: se recorta el relleno del ultimo
+    if (archivo->backend == IO_DIRECTO) {
+        if (archivo->fd >= 0) {
+            pthread_mutex_lock(&mutexPool);
+            liberarMarcosArchivo(archivo);
+            pthread_mutex_unlock(&mutexPool);
+            if (archivo->escritura &&
+                ftruncate(archivo->fd, (off_t)(archivo->file_elementos * ELEMENT_SIZE)) != 0) {
+                perror("ftruncate");
+            }
+            close(archivo->fd);
+            archivo->fd = -1;
+            contarArchivoAbierto(-1);
+        }
+        archivo->buffer = NULL;
+        return;
+    }
+
+    //cerrar archivo, antes se escriben sus bloques sucios del pool
+    if (archivo->file) {
+        pthread_mutex_lock(&mutexPool);
+        liberarMarcosArchivo(archivo);
+        pthread_mutex_unlock(&mutexPool);
+        fclose(archivo->file);
+        if (archivo->escritura) {
+            contarDescarga(archivo->estadisticas); //fclose baja el buffer de stdio
+        }
+        archivo->file = NULL;
+        contarArchivoAbierto(-1);
+    }
+    archivo->buffer = NULL;
+}
+
+/*
+lee un elemento específico del archivo
+archivo: estructura del archivo
+posicion: posición del elemento (indice)
+elemento: puntero donde almacenar el elemento leido
+return 0 si exito, -1 si error
+ */
+int leerElemento(ArchivoBin *archivo, size_t pos, int64_t *elemento) {
+    assert(archivo != NULL && elemento != NULL);
+    if (!dentroDeVista(archivo, pos, 1)) {
+        return -1;
+    }
+    pos += archivo->desplazamiento;
+
+    //archivo mapeado: acceso directo con puntero
+    if (archivo->backend == IO_MMAP) {
+        if (pos >= archivo->file_elementos) {
+            *elemento = 0;
+            return 0;
+        }
+        size_t bloqIdx = pos / archivo->elementosBloque;
+        if (bloqIdx != archivo->bloqActual) {
+            tocarBloquesMapa(archivo, bloqIdx, bloqIdx, 0);
+            archivo->bloqActual = bloqIdx;
+        }
+        *elemento = archivo->mapa[pos];
+        return 0;
+    }
+    
+    //calcular el bloque en que esta el elemento
+    size_t bloqIdx = pos / archivo->elementosBloque;
+    size_t offset_en_bloque = pos % archivo->elementosBloque;
+    
+    //cargar el bloque correspondiente si es necesario
+    pthread_mutex_lock(&mutexPool);
+    if (leerBloqueInterno(archivo, bloqIdx) != 0) {
+        pthread_mutex_unlock(&mutexPool);
+        return -1;
+    }
+    
+    //leer el elemento del buffer en memoria
+    *elemento = archivo->buffer[offset_en_bloque];
+    pthread_mutex_unlock(&mutexPool);
+    return 0;
+}
+
+/*
+Escribe un elemento específico en el archivo
+archivo: estructura del archivo
+pos: posición donde escribir el elemento
+elemento: elemento a escribir
+return 0 si exito, -1 si error
+ */
+int escribirElemento(ArchivoBin *archivo, size_t pos, int64_t elemento) {
+    assert(archivo != NULL);
+    if (!dentroDeVista(archivo, pos, 1)) {
+        return -1;
+    }
+    pos += archivo->desplazamiento;
+
+    //archivo mapeado: acceso directo con puntero
+    if (archivo->backend == IO_MMAP) {
+        if (pos >= archivo->capacidad && asegurarCapacidadMapa(archivo, pos + 1) != 0) {
+            return -1;
+        }
+        size_t bloqIdx = pos / archivo->elementosBloque;
+        if (bloqIdx != archivo->bloqActual || !(archivo->estadoBloques[bloqIdx] & BLOQUE_ESCRITO)) {
+            tocarBloquesMapa(archivo, bloqIdx, bloqIdx, 1);
+            archivo->bloqActual = bloqIdx;
+        }
+        archivo->mapa[pos] = elemento;
+        if (pos >= archivo->file_elementos) {
+            archivo->file_elementos = pos + 1;
+        }
+        return 0;
+    }
+    
+    //calcular en que bloque esta el elemento
+    size_t bloque_num = pos / archivo->elementosBloque;
+    size_t offset_en_bloque = pos % archivo->elementosBloque;
+    
+    //cargar el bloque si es necesario
+    pthread_mutex_lock(&mutexPool);
+    if (leerBloqueInterno(archivo, bloque_num) != 0) {
+        pthread_mutex_unlock(&mutexPool);
+        return -1;
+    }
+    
+    //escribir el elemento en el buffer de memoria
+    archivo->buffer[offset_en_bloque] = elemento;
+    marcos[archivo->marco].sucio = 1;  //marcar bloque como modificado
+
+    //el archivo crece si se escribe despues de su final (antes de soltar el pool,
+    //para que un desalojo desde otro hilo escriba el elemento)
+    if (pos >= archivo->file_elementos) {
+        archivo->file_elementos = pos + 1;
+    }
+    pthread_mutex_unlock(&mutexPool);
+    
+    return 0;
+}
+
+/*
+lee n elementos consecutivos desde pos con un solo fread
+los bloques del rango que estan sucios en el pool se escriben antes, y se cuenta
+un acceso por cada bloque con datos que no estaba en el pool (igual que leerElemento)
+archivo: estructura del archivo
+pos: posicion del primer elemento
+n: cantidad de elementos a leer
+dst: arreglo donde dejar los elementos (los que quedan fuera del archivo quedan en 0)
+return: 0 si exito, -1 si error
+*/
+static int leerRangoInterno(ArchivoBin *archivo, size_t pos, size_t n, int64_t *dst) {
+    assert(archivo != NULL && dst != NULL);
+    if (n == 0) {
+        return 0;
+    }
+
+    //solo se lee lo que existe en el archivo
+    size_t disponibles = 0;
+    if (pos < archivo->file_elementos) {
+        disponibles = archivo->file_elementos - pos;
+        if (disponibles > n) {
+            disponibles = n;
+        }
+    }
+
+    if (disponibles > 0 && archivo->backend == IO_MMAP) {
+        tocarBloquesMapa(archivo, pos / archivo->elementosBloque,
+                         (pos + disponibles - 1) / archivo->elementosBloque, 0);
+        memcpy(dst, archivo->mapa + pos, disponibles * ELEMENT_SIZE);
+    } else if (disponibles > 0) {
+        size_t primerBloque = pos / archivo->elementosBloque;
+        size_t ultimoBloque = (pos + disponibles - 1) / archivo->elementosBloque;
+
+        //asegurar que el disco tenga lo ultimo escrito en el pool
+        long long faltantes = 0;
+        for (size_t b = primerBloque; b <= ultimoBloque; b++) {
+            int m = buscarMarco(archivo, b);
+            if (m >= 0) {
+                if (escribirMarco(m) != 0) {
+                    return -1;
+                }
+            } else {
+                faltantes++; //bloque que se trae desde disco
+            }
+        }
+        contarTransferencia(archivo->estadisticas, 0, faltantes, disponibles * ELEMENT_SIZE);
+        contarSalto(archivo->estadisticas, &archivo->siguienteBloque, primerBloque, ultimoBloque + 1);
+
+        if (archivo->backend == IO_DIRECTO) {
+            if (leerRangoDirecto(archivo, pos, disponibles, dst) != 0) {
+                return -1;
+            }
+        } else {
+            if (fseek(archivo->file, (long)(pos * ELEMENT_SIZE), SEEK_SET) != 0) {
+                return -1;
+            }
+            size_t leidos = fread(dst, ELEMENT_SIZE, disponibles, archivo->file);
+            if (ferror(archivo->file)) {
+                clearerr(archivo->file);
+                return -1;
+            }
+            //lo escrito en el pool despues del final fisico del archivo queda en 0
+            if (leidos < disponibles) {
+                memset(dst + leidos, 0, (disponibles - leidos) * ELEMENT_SIZE);
+            }
+        }
+    }
+
+    if (disponibles < n) {
+        memset(dst + disponibles, 0, (n - disponibles) * ELEMENT_SIZE);
+    }
+
+    return 0;
+}
+
+/*
+escribe n elementos consecutivos desde pos con un solo fwrite
+los bloques del rango que estan en el pool se actualizan para no quedar obsoletos,
+y se cuenta un acceso por cada bloque escrito
+archivo: estructura del archivo
+pos: posicion del primer elemento
+n: cantidad de elementos a escribir
+src: elementos a escribir
+return: 0 si exito, -1 si error
+*/
+static int escribirRangoInterno(ArchivoBin *archivo, size_t pos, size_t n, const int64_t *src) {
+    assert(archivo != NULL && src != NULL);
+    if (n == 0) {
+        return 0;
+    }
+
+    if (archivo->backend == IO_MMAP) {
+        if (asegurarCapacidadMapa(archivo, pos + n) != 0) {
+            return -1;
+        }
+        tocarBloquesMapa(archivo, pos / archivo->elementosBloque, (pos + n - 1) / archivo->elementosBloque, 1);
+        memcpy(archivo->mapa + pos, src, n * ELEMENT_SIZE);
+        if (pos + n > archivo->file_elementos) {
+            archivo->file_elementos = pos + n;
+        }
+        return 0;
+    }
+
+    size_t primerBloque = pos / archivo->elementosBloque;
+    size_t ultimoBloque = (pos + n - 1) / archivo->elementosBloque;
+
+    for (size_t b = primerBloque; b <= ultimoBloque; b++) {
+        int m = buscarMarco(archivo, b);
+        if (m >= 0) {
+            //copiar la parte del rango que cae en este bloque
+            size_t inicioBloque = b * archivo->elementosBloque;
+            size_t desde = (pos > inicioBloque) ? pos : inicioBloque;
+            size_t hasta = inicioBloque + archivo->elementosBloque;
+            if (hasta > pos + n) {
+                hasta = pos + n;
+            }
+            memcpy(marcos[m].datos + (desde - inicioBloque), src + (desde - pos),
+                   (hasta - desde) * ELEMENT_SIZE);
+        }
+    }
+    contarTransferencia(archivo->estadisticas, 1, ultimoBloque - primerBloque + 1, n * ELEMENT_SIZE);
+    contarSalto(archivo->estadisticas, &archivo->siguienteBloque, primerBloque, ultimoBloque + 1);
+
+    if (archivo->backend == IO_DIRECTO) {
+        if (escribirRangoDirecto(archivo, pos, n, src) != 0) {
+            return -1;
+        }
+    } else {
+        if (fseek(archivo->file, (long)(pos * ELEMENT_SIZE), SEEK_SET) != 0) {
+            return -1;
+        }
+        if (fwrite(src, ELEMENT_SIZE, n, archivo->file) != n) {
+            return -1;
+        }
+    }
+
+    //el archivo crece si se escribe despues de su final
+    if (pos + n > archivo->file_elementos) {
+        archivo->file_elementos = pos + n;
+    }
+
+    return 0;
+}
+
+//leerRango y escribirRango toman el pool mientras usan el archivo (salvo si esta mapeado)
+int leerRango(ArchivoBin *archivo, size_t pos, size_t n, int64_t *dst) {
+    if (!dentroDeVista(archivo, pos, n)) {
+        return -1;
+    }
+    pos += archivo->desplazamiento;
+    if (archivo->backend == IO_MMAP) {
+        return leerRangoInterno(archivo, pos, n, dst);
+    }
+    pthread_mutex_lock(&mutexPool);
+    int resultado = leerRangoInterno(archivo, pos, n, dst);
+    pthread_mutex_unlock(&mutexPool);
+    return resultado;
+}
+
+int escribirRango(ArchivoBin *archivo, size_t pos, size_t n, const int64_t *src) {
+    if (!dentroDeVista(archivo, pos, n)) {
+        return -1;
+    }
+    pos += archivo->desplazamiento;
+    if (archivo->backend == IO_MMAP) {
+        return escribirRangoInterno(archivo, pos, n, src);
+    }
+    pthread_mutex_lock(&mutexPool);
+    int resultado = escribirRangoInterno(archivo, pos, n, src);
+    pthread_mutex_unlock(&mutexPool);
+    return resultado;
+}
+
+//motor de I/O asincrono: un hilo dedicado atiende una cola de lecturas y escrituras
+static pthread_t hiloIO;
+static int motorActivo = 0;
+static int detenerMotor = 0;
+static pthread_mutex_t mutexIO = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t hayTrabajo = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t hayResultado = PTHREAD_COND_INITIALIZER;
+static SolicitudIO *colaInicio = NULL;
+static SolicitudIO *colaFin = NULL;
+
+//ciclo del hilo de I/O: toma solicitudes en orden y las hace con pread/pwrite
+static void *cicloMotorIO(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&mutexIO);
+    while (1) {
+        while (colaInicio == NULL && !detenerMotor) {
+            pthread_cond_wait(&hayTrabajo, &mutexIO);
+        }
+        if (colaInicio == NULL && detenerMotor) {
+            break;
+        }
+
+        SolicitudIO *solicitud = colaInicio;
+        colaInicio = solicitud->siguiente;
+        if (colaInicio == NULL) {
+            colaFin = NULL;
+        }
+        solicitud->estado = SOLICITUD_EN_CURSO;
+        pthread_mutex_unlock(&mutexIO);
+
+        //leer o escribir sin el lock para que el consumidor siga trabajando
+        size_t total = 0;
+        long resultado = 0;
+        while (total < solicitud->bytes) {
+            ssize_t r;
+            if (solicitud->esEscritura) {
+                r = pwrite(solicitud->fd, (char*)solicitud->destino + total,
+                           solicitud->bytes - total, solicitud->offset + (off_t)total);
+            } else {
+                r = pread(solicitud->fd, (char*)solicitud->destino + total,
+                          solicitud->bytes - total, solicitud->offset + (off_t)total);
+            }
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                resultado = -1;
+                break;
+            }
+            if (r == 0) break;
+            total += r;
+        }
+        if (resultado == 0) {
+            resultado = (long)total;
+        }
+
+        pthread_mutex_lock(&mutexIO);
+        solicitud->resultado = resultado;
+        solicitud->estado = SOLICITUD_LISTA;
+        pthread_cond_broadcast(&hayResultado);
+    }
+    pthread_mutex_unlock(&mutexIO);
+    return NULL;
+}
+
+//pone una solicitud en la cola del motor (lo inicia si no esta corriendo)
+static int encolarSolicitud(SolicitudIO *solicitud) {
+    pthread_mutex_lock(&mutexIO);
+    if (!motorActivo) {
+        detenerMotor = 0;
+        if (pthread_create(&hiloIO, NULL, cicloMotorIO, NULL) != 0) {
+            pthread_mutex_unlock(&mutexIO);
+            return -1;
+        }
+        motorActivo = 1;
+    }
+    solicitud->estado = SOLICITUD_PENDIENTE;
+    solicitud->siguiente = NULL;
+    if (colaFin) {
+        colaFin->siguiente = solicitud;
+    } else {
+        colaInicio = solicitud;
+    }
+    colaFin = solicitud;
+    pthread_cond_signal(&hayTrabajo);
+    pthread_mutex_unlock(&mutexIO);
+    return 0;
+}
+
+//espera a que una solicitud termine y entrega su resultado
+static long esperarSolicitud(SolicitudIO *solicitud) {
+    pthread_mutex_lock(&mutexIO);
+    while (solicitud->estado == SOLICITUD_PENDIENTE || solicitud->estado == SOLICITUD_EN_CURSO) {
+        pthread_cond_wait(&hayResultado, &mutexIO);
+    }
+    long resultado = solicitud->resultado;
+    solicitud->estado = SOLICITUD_LIBRE;
+    pthread_mutex_unlock(&mutexIO);
+    return resultado;
+}
+
+//revisa si una solicitud no tiene nada pendiente (el motor cambia su estado)
+static int solicitudLibre(SolicitudIO *solicitud) {
+    pthread_mutex_lock(&mutexIO);
+    int libre = (solicitud->estado == SOLICITUD_LIBRE);
+    pthread_mutex_unlock(&mutexIO);
+    return libre;
+}
+
+//saca una solicitud de la cola si aun no empieza, o espera a que termine
+static void cancelarSolicitud(SolicitudIO *solicitud) {
+    pthread_mutex_lock(&mutexIO);
+    if (solicitud->estado == SOLICITUD_PENDIENTE) {
+        SolicitudIO **enlace = &colaInicio;
+        SolicitudIO *anterior = NULL;
+        while (*enlace && *enlace != solicitud) {
+            anterior = *enlace;
+            enlace = &(*enlace)->siguiente;
+        }
+        if (*enlace) {
+            *enlace = solicitud->siguiente;
+            if (colaFin == solicitud) {
+                colaFin = anterior;
+            }
+        }
+        solicitud->estado = SOLICITUD_LIBRE;
+    }
+    while (solicitud->estado == SOLICITUD_EN_CURSO) {
+        pthread_cond_wait(&hayResultado, &mutexIO);
+    }
+    solicitud->estado = SOLICITUD_LIBRE;
+    pthread_mutex_unlock(&mutexIO);
+}
+
+/*
+detiene el hilo de I/O cuando ya no quedan lectores abiertos
+*/
+void detenerMotorIO(void) {
+    pthread_mutex_lock(&mutexIO);
+    if (!motorActivo) {
+        pthread_mutex_unlock(&mutexIO);
+        return;
+    }
+    detenerMotor = 1;
+    pthread_cond_signal(&hayTrabajo);
+    pthread_mutex_unlock(&mutexIO);
+
+    pthread_join(hiloIO, NULL);
+    motorActivo = 0;
+}
+
+/*
+escribe en disco todo lo que un archivo tiene pendiente (marcos sucios del pool y
+buffer de stdio), para que otro descriptor pueda leer el contenido actual
+archivo: estructura del archivo
+return: 0 si exito, -1 si error
+*/
+int sincronizarArchivo(ArchivoBin *archivo) {
+    if (archivo->backend == IO_MMAP) {
+        return 0;
+    }
+    pthread_mutex_lock(&mutexPool);
+    int resultado = 0;
+    for (int i = 0; i < numMarcos && resultado == 0; i++) {
+        if (marcos[i].dueño == archivo && marcos[i].idDueño == archivo->id &&
+            escribirMarco(i) != 0) {
+            resultado = -1;
+        }
+    }
+    if (resultado == 0 && archivo->file) {
+        if (fflush(archivo->file) != 0) {
+            resultado = -1;
+        } else {
+            contarDescarga(archivo->estadisticas);
+        }
+    }
+    pthread_mutex_unlock(&mutexPool);
+    return resultado;
+}
+
+/*
+pide al motor el trozo de un flujo de lectura que sigue a *siguienteLectura, en
+bloques completos y alineados (necesario con O_DIRECT) y sin pasar del bloque que
+contiene el final del rango
+archivo: archivo del flujo
+fd: descriptor propio del flujo
+siguienteLectura: posicion del trozo a pedir, avanza al trozo siguiente
+fin: posicion final (exclusiva) del rango
+elementosPorBuffer: tamaño del buffer
+buffer: donde leer
+solicitud: solicitud para el motor
+inicioTrozo: aqui se deja la posicion del trozo, SIZE_MAX si no queda nada por pedir
+return: 0 si exito, -1 si error
+*/
+static int pedirTrozo(ArchivoBin *archivo, int fd, size_t *siguienteLectura, size_t fin,
+                      size_t elementosPorBuffer, int64_t *buffer, SolicitudIO *solicitud,
+                      size_t *inicioTrozo) {
+    if (*siguienteLectura >= fin) {
+        *inicioTrozo = SIZE_MAX;
+        return 0;
+    }
+
+    size_t bloque = *siguienteLectura / archivo->elementosBloque;
+    *inicioTrozo = bloque * archivo->elementosBloque;
+    *siguienteLectura = *inicioTrozo + elementosPorBuffer;
+
+    size_t finAlineado = (fin + archivo->elementosBloque - 1) / archivo->elementosBloque * archivo->elementosBloque;
+    size_t elementos = finAlineado - *inicioTrozo;
+    if (elementos > elementosPorBuffer) {
+        elementos = elementosPorBuffer;
+    }
+
+    solicitud->fd = fd;
+    solicitud->esEscritura = 0;
+    solicitud->destino = buffer;
+    solicitud->bytes = elementos * ELEMENT_SIZE;
+    solicitud->offset = (off_t)(bloque * archivo->tamBloque);
+    return encolarSolicitud(solicitud);
+}
+
+/*
+espera un trozo pedido con pedirTrozo, cuenta sus bloques y ubica su parte util
+dentro de [inicio, fin)
+return: 1 si el trozo tiene elementos del rango, 0 si no, -1 si error
+*/
+static int recibirTrozo(ArchivoBin *archivo, SolicitudIO *solicitud, size_t inicioTrozo,
+                        size_t inicio, size_t fin, size_t *siguienteBloque,
+                        size_t *posEnBuffer, size_t *elementosEnBuffer) {
+    long bytes = esperarSolicitud(solicitud);
+    if (bytes < 0) {
+        return -1;
+    }
+    size_t primerBloque = inicioTrozo / archivo->elementosBloque;
+    size_t bloques = (bytes + archivo->tamBloque - 1) / archivo->tamBloque;
+    contarTransferencia(archivo->estadisticas, 0, bloques, bytes);
+    contarSalto(archivo->estadisticas, siguienteBloque, primerBloque, primerBloque + bloques);
+
+    size_t hasta = inicioTrozo + (size_t)bytes / ELEMENT_SIZE;
+    if (hasta > fin) {
+        hasta = fin;
+    }
+    size_t salto = (inicio > inicioTrozo) ? inicio - inicioTrozo : 0;
+    if (hasta <= inicioTrozo + salto) {
+        return 0; //trozo vacio (p.ej. el archivo se acorto)
+    }
+    *posEnBuffer = salto;
+    *elementosEnBuffer = hasta - inicioTrozo;
+    return 1;
+}
+
+//pide al motor el siguiente trozo del rango en el buffer b
+static int pedirBuffer(LectorSecuencial *lector, int b) {
+    return pedirTrozo(lector->archivo, lector->fd, &lector->siguienteLectura, lector->fin,
+                      lector->elementosPorBuffer, lector->buffers[b], &lector->solicitudes[b],
+                      &lector->inicioBuffer[b]);
+}
+
+/*
+abre un descriptor propio para leer un archivo desde el hilo de I/O (con O_DIRECT
+si el backend lo usa), despues de bajar a disco lo pendiente del archivo
+return: descriptor, -1 si error
+*/
+static int abrirDescriptorLectura(ArchivoBin *archivo) {
+    if (sincronizarArchivo(archivo) != 0) {
+        return -1;
+    }
+    int flags = O_RDONLY;
+#ifdef O_DIRECT
+    if (archivo->backend == IO_DIRECTO) {
+        flags |= O_DIRECT;
+    }
+#endif
+    int fd = open(archivo->filename, flags);
+    if (fd < 0 && archivo->backend == IO_DIRECTO) {
+        fd = open(archivo->filename, O_RDONLY);
+    }
+    return fd;
 }
 
-//entrega accesos registrados
-long long obtenerAccesos(){
-    return accesos;
+//rango [inicio, fin) no vacio de un archivo mapeado: se avisa al kernel que se va a
+//leer y se cuentan sus bloques
+static const int64_t *rangoMapeado(ArchivoBin *archivo, size_t inicio, size_t fin) {
+    size_t primero = inicio / archivo->elementosBloque;
+    size_t ultimo = (fin - 1) / archivo->elementosBloque;
+    size_t pagina = (size_t)sysconf(_SC_PAGESIZE);
+    size_t desde = (inicio * ELEMENT_SIZE) / pagina * pagina;
+    madvise((char*)archivo->mapa + desde, fin * ELEMENT_SIZE - desde, MADV_WILLNEED);
+    tocarBloquesMapa(archivo, primero, ultimo, 0);
+    return archivo->mapa + inicio;
 }
 
 /*
-lee bloque tamaño B del archivo binario
-archivo: estructura del archivo
-bloqueIdx: indice o numero del bloque a leer
-return: 0 si exito -1 si error
+abre un lector secuencial sobre [inicio, fin) de un archivo abierto
+se piden de inmediato numBuffers trozos de bloquesPorBuffer bloques al hilo de I/O,
+y cada trozo consumido se vuelve a pedir para la siguiente parte del rango
+lector: estructura del lector
+archivo: archivo abierto de donde leer
+inicio: primer elemento a leer
+fin: posicion final (exclusiva)
+numBuffers: cantidad de buffers en vuelo
+bloquesPorBuffer: bloques de cada lectura
+return: 0 si exito, -1 si error
 */
-int leerBloque(ArchivoBin *archivo, size_t bloqIdx){
-    assert(archivo != NULL);
-    assert(archivo->file != NULL);
-    assert(archivo->buffer !=NULL);
+int abrirLector(LectorSecuencial *lector, ArchivoBin *archivo, size_t inicio, size_t fin,
+                int numBuffers, size_t bloquesPorBuffer) {
+    memset(lector, 0, sizeof(*lector));
+    if (!dentroDeVista(archivo, inicio, (fin > inicio) ? fin - inicio : 0)) {
+        return -1;
+    }
+    inicio += archivo->desplazamiento;
+    fin += archivo->desplazamiento;
+    lector->archivo = archivo;
+    lector->fd = -1;
+    lector->inicio = inicio;
+    lector->fin = (fin < archivo->file_elementos) ? fin : archivo->file_elementos;
+    lector->actual = -1;
 
-    //si el bloque ya esta cargado no se hace nada
-    if (archivo->bloqActual == bloqIdx){
+    if (lector->fin <= inicio) {
+        lector->fin = inicio;
         return 0;
     }
 
-    //si esta sucio agregar modificaciones
-    if (archivo->sucio){
-        if(escribirBloque(archivo) != 0){
-            return -1;
-        }
+    //archivo mapeado: el rango ya esta en memoria
+    if (archivo->backend == IO_MMAP) {
+        lector->datos = rangoMapeado(archivo, inicio, lector->fin);
+        lector->elementosEnBuffer = lector->fin - inicio;
+        return 0;
     }
 
-    //para posicionarse en bloque
-    long offset = bloqIdx * BLOCK_SIZE; 
+    //descriptor propio para que el hilo de I/O no comparta el FILE del archivo
+    lector->fd = abrirDescriptorLectura(archivo);
+    if (lector->fd < 0) {
+        return -1;
+    }
 
-    //posicionarse en archivo
-    if (fseek(archivo->file, offset, SEEK_SET) != 0){
+    if (numBuffers < 1) numBuffers = 1;
+    if (bloquesPorBuffer < 1) bloquesPorBuffer = 1;
+    lector->numBuffers = numBuffers;
+    lector->elementosPorBuffer = bloquesPorBuffer * archivo->elementosBloque;
+    lector->siguienteLectura = inicio;
+    lector->buffers = calloc(numBuffers, sizeof(int64_t*));
+    lector->solicitudes = calloc(numBuffers, sizeof(SolicitudIO));
+    lector->inicioBuffer = malloc(numBuffers * sizeof(size_t));
+    if (!lector->buffers || !lector->solicitudes || !lector->inicioBuffer) {
+        cerrarLector(lector);
         return -1;
     }
-    
-    //leer bloques tamaño B
-    size_t elementosLeidos = fread(archivo->buffer, ELEMENT_SIZE, ELEMENTS_PER_BLOCK, archivo->file);
-    accesos++; //incrementar contador de accesos a disco
 
-    //luego de leer el bloque se rellena con ceros
-    if (elementosLeidos < ELEMENTS_PER_BLOCK){
-        memset(archivo->buffer + elementosLeidos, 0, (ELEMENTS_PER_BLOCK - elementosLeidos) * ELEMENT_SIZE);
+    for (int b = 0; b < numBuffers; b++) {
+        if (posix_memalign((void**)&lector->buffers[b], ALINEAMIENTO_IO,
+                           lector->elementosPorBuffer * ELEMENT_SIZE) != 0) {
+            lector->buffers[b] = NULL;
+            cerrarLector(lector);
+            return -1;
+        }
+        if (pedirBuffer(lector, b) != 0) {
+            cerrarLector(lector);
+            return -1;
+        }
+    }
+
+    return 0;
+}
 
+/*
+pasa al siguiente buffer del lector: vuelve a pedir el que se termino de consumir
+y espera (si aun no llega) al siguiente en orden
+lector: lector secuencial abierto
+return: 1 si hay elementos disponibles, 0 si se llego al final, -1 si error
+*/
+int avanzarLector(LectorSecuencial *lector) {
+    if (lector->fd < 0) {
+        return 0; //mapeado o vacio: todo se entrego en el primer buffer
     }
 
-    archivo->bloqActual = bloqIdx;
-    archivo->sucio = 0; //buffer se limpia luego de leer
+    while (1) {
+        //el buffer consumido se reutiliza para la parte siguiente del rango
+        if (lector->actual >= 0) {
+            if (pedirBuffer(lector, lector->actual) != 0) {
+                return -1;
+            }
+        }
+        lector->actual = (lector->actual + 1) % lector->numBuffers;
+        int b = lector->actual;
 
-    return 0;
+        if (lector->inicioBuffer[b] == SIZE_MAX) {
+            lector->elementosEnBuffer = 0;
+            lector->posEnBuffer = 0;
+            return 0;
+        }
+
+        //parte util del buffer: dentro de [inicio, fin)
+        int r = recibirTrozo(lector->archivo, &lector->solicitudes[b], lector->inicioBuffer[b],
+                             lector->inicio, lector->fin, &lector->siguienteBloque,
+                             &lector->posEnBuffer, &lector->elementosEnBuffer);
+        if (r < 0) {
+            return -1;
+        }
+        if (r == 0) {
+            continue;
+        }
+        lector->datos = lector->buffers[b];
+        return 1;
+    }
 }
 
 /*
-escribe un bloque tamaño B en el archivo binario
-archivo: estructura del archivo
-return: 0 si exito, -1 si error 
+copia hasta n elementos siguientes del lector a dst
+return: cantidad de elementos copiados (menos que n solo al final del rango), -1 si
+error (un error de lectura no se confunde con el final del rango)
 */
-int escribirBloque(ArchivoBin *archivo){
-    assert(archivo != NULL);
-    assert(archivo->file != NULL);
-    assert(archivo->buffer != NULL);
+long leerSiguientes(LectorSecuencial *lector, size_t n, int64_t *dst) {
+    size_t copiados = 0;
+    while (copiados < n) {
+        if (lector->posEnBuffer >= lector->elementosEnBuffer) {
+            int r = avanzarLector(lector);
+            if (r < 0) {
+                return -1;
+            }
+            if (r == 0) {
+                break;
+            }
+        }
+        size_t cantidad = lector->elementosEnBuffer - lector->posEnBuffer;
+        if (cantidad > n - copiados) {
+            cantidad = n - copiados;
+        }
+        memcpy(dst + copiados, lector->datos + lector->posEnBuffer, cantidad * ELEMENT_SIZE);
+        lector->posEnBuffer += cantidad;
+        copiados += cantidad;
+    }
+    return (long)copiados;
+}
 
-    if (!archivo->sucio || archivo->bloqActual == SIZE_MAX) {
-        return 0;  //solo escribir si el buffer esta sucio
+/*
+cierra un lector: cancela las lecturas pendientes y libera sus buffers
+*/
+void cerrarLector(LectorSecuencial *lector) {
+    if (lector->solicitudes) {
+        for (int b = 0; b < lector->numBuffers; b++) {
+            cancelarSolicitud(&lector->solicitudes[b]);
+        }
     }
+    if (lector->buffers) {
+        for (int b = 0; b < lector->numBuffers; b++) {
+            free(lector->buffers[b]);
+        }
+    }
+    free(lector->buffers);
+    free(lector->solicitudes);
+    free(lector->inicioBuffer);
+    if (lector->fd >= 0) {
+        close(lector->fd);
+    }
+    memset(lector, 0, sizeof(*lector));
+    lector->fd = -1;
+}
 
-    //offset para posicionarse en el bloque
-    long offset = archivo->bloqActual * BLOCK_SIZE;
-    
-    if (fseek(archivo->file, offset, SEEK_SET) != 0) {
+/*
+abre la lectura con pronostico de las k entradas de una mezcla: cada entrada pide
+de inmediato su primer trozo, y los PRONOSTICO_RESERVA buffers de reserva se usan
+despues para leer por adelantado
+lector: estructura de la lectura
+archivos: entradas abiertas
+desde: primer elemento a leer de cada entrada, NULL para leerlas completas
+hasta: posicion final (exclusiva) en cada entrada, NULL para leerlas completas
+k: cantidad de entradas
+bloquesPorBuffer: bloques de cada buffer (de las entradas y de la reserva)
+return: 0 si exito, -1 si error
+*/
+int abrirLectorPronostico(LectorPronostico *lector, ArchivoBin *archivos, const size_t *desde,
+                          const size_t *hasta, int k, size_t bloquesPorBuffer) {
+    memset(lector, 0, sizeof(*lector));
+    for (int r = 0; r < PRONOSTICO_RESERVA; r++) {
+        lector->dueño[r] = -1;
+    }
+    if (k < 1) {
         return -1;
     }
-    
-    //escribir bloque de tamaño B
-    size_t elementosEscritos = fwrite(archivo->buffer, ELEMENT_SIZE, ELEMENTS_PER_BLOCK, archivo->file);
-    accesos++;  //incrementar contador de accesos
-    
-    if (elementosEscritos != ELEMENTS_PER_BLOCK) {
+    if (bloquesPorBuffer < 1) bloquesPorBuffer = 1;
+    lector->k = k;
+    lector->elementosPorBuffer = bloquesPorBuffer * archivos[0].elementosBloque;
+    lector->entradas = calloc(k, sizeof(EntradaPronostico));
+    if (!lector->entradas) {
         return -1;
     }
-    
-    archivo->sucio = 0;  //limpiar buffer
+
+    for (int i = 0; i < k; i++) {
+        lector->entradas[i].fd = -1;
+        lector->entradas[i].adelantado = -1;
+        lector->entradas[i].inicioBuffer = SIZE_MAX;
+    }
+
+    int leeDelDisco = 0;
+    for (int i = 0; i < k; i++) {
+        EntradaPronostico *e = &lector->entradas[i];
+        ArchivoBin *archivo = &archivos[i];
+        size_t inicio = desde ? desde[i] : 0;
+        size_t fin = hasta ? hasta[i] : elementosArchivo(archivo);
+        if (!dentroDeVista(archivo, inicio, (fin > inicio) ? fin - inicio : 0)) {
+            cerrarLectorPronostico(lector);
+            return -1;
+        }
+        fin += archivo->desplazamiento;
+        e->archivo = archivo;
+        e->inicio = inicio + archivo->desplazamiento;
+        e->fin = (fin < archivo->file_elementos) ? fin : archivo->file_elementos;
+        if (e->fin <= e->inicio) {
+            e->fin = e->inicio;
+            continue;
+        }
+
+        //archivo mapeado: el rango ya esta en memoria
+        if (archivo->backend == IO_MMAP) {
+            e->datos = rangoMapeado(archivo, e->inicio, e->fin);
+            e->elementosEnBuffer = e->fin - e->inicio;
+            continue;
+        }
+
+        e->fd = abrirDescriptorLectura(archivo);
+        if (e->fd < 0 || posix_memalign((void**)&e->buffer, ALINEAMIENTO_IO,
+                                        lector->elementosPorBuffer * ELEMENT_SIZE) != 0) {
+            e->buffer = NULL;
+            cerrarLectorPronostico(lector);
+            return -1;
+        }
+        e->siguienteLectura = e->inicio;
+        if (pedirTrozo(archivo, e->fd, &e->siguienteLectura, e->fin, lector->elementosPorBuffer,
+                       e->buffer, &e->solicitud, &e->inicioBuffer) != 0) {
+            cerrarLectorPronostico(lector);
+            return -1;
+        }
+        e->esperando = 1;
+        leeDelDisco = 1;
+    }
+
+    for (int r = 0; r < PRONOSTICO_RESERVA && leeDelDisco; r++) {
+        if (posix_memalign((void**)&lector->reserva[r], ALINEAMIENTO_IO,
+                           lector->elementosPorBuffer * ELEMENT_SIZE) != 0) {
+            lector->reserva[r] = NULL;
+            cerrarLectorPronostico(lector);
+            return -1;
+        }
+    }
     return 0;
 }
 
+//lanza lecturas adelantadas mientras haya buffers de reserva libres, cada una para
+//la entrada sin adelanto cuyo buffer termina con la menor clave: la mezcla la agota
+//antes que a las otras
+static int pronosticar(LectorPronostico *lector) {
+    for (int r = 0; r < PRONOSTICO_RESERVA; r++) {
+        if (lector->dueño[r] >= 0 || !lector->reserva[r]) {
+            continue;
+        }
+        int elegida = -1;
+        int64_t menor = 0;
+        for (int i = 0; i < lector->k; i++) {
+            EntradaPronostico *e = &lector->entradas[i];
+            if (e->fd < 0 || e->esperando || e->adelantado >= 0 || e->elementosEnBuffer == 0 ||
+                e->siguienteLectura >= e->fin) {
+                continue;
+            }
+            int64_t ultima = e->datos[e->elementosEnBuffer - 1];
+            if (elegida < 0 || ultima < menor) {
+                elegida = i;
+                menor = ultima;
+            }
+        }
+        if (elegida < 0) {
+            return 0;
+        }
+
+        EntradaPronostico *e = &lector->entradas[elegida];
+        if (pedirTrozo(e->archivo, e->fd, &e->siguienteLectura, e->fin, lector->elementosPorBuffer,
+                       lector->reserva[r], &lector->solicitudes[r], &lector->inicioReserva[r]) != 0) {
+            return -1;
+        }
+        lector->dueño[r] = elegida;
+        e->adelantado = r;
+    }
+    return 0;
+}
 
 /*
-convierte bloque binario en arreglo en memoria principal
-archivo: estructura del archivo
-bloqIdx: indice del bloque
-return: 0 si exito, -1 si error
- */
-int cargarEnMemoria(ArchivoBin *archivo, size_t bloqIdx){
-     return leerBloque(archivo, bloqIdx);
+pasa al siguiente trozo de una entrada: si se pronostico, su buffer de la reserva
+pasa a ser el de la entrada y el consumido queda libre en la reserva; si no, se
+pide ahora y se espera. luego se pronostica con los buffers de reserva libres
+lector: lectura con pronostico abierta
+entrada: entrada cuyo buffer se consumio
+return: 1 si hay elementos disponibles, 0 si la entrada se termino, -1 si error
+*/
+int avanzarPronostico(LectorPronostico *lector, int entrada) {
+    EntradaPronostico *e = &lector->entradas[entrada];
+    if (e->fd < 0) {
+        return 0; //mapeada o vacia: todo se entrego en el primer buffer
+    }
+
+    while (1) {
+        int recibido;
+        if (e->esperando) {
+            //trozo pedido en el buffer propio (el primero, o uno que no se pronostico)
+            e->esperando = 0;
+            recibido = recibirTrozo(e->archivo, &e->solicitud, e->inicioBuffer, e->inicio, e->fin,
+                                    &e->siguienteBloque, &e->posEnBuffer, &e->elementosEnBuffer);
+        } else if (e->adelantado >= 0) {
+            int r = e->adelantado;
+            int64_t *consumido = e->buffer;
+            e->buffer = lector->reserva[r];
+            lector->reserva[r] = consumido;
+            e->adelantado = -1;
+            recibido = recibirTrozo(e->archivo, &lector->solicitudes[r], lector->inicioReserva[r],
+                                    e->inicio, e->fin, &e->siguienteBloque, &e->posEnBuffer,
+                                    &e->elementosEnBuffer);
+            lector->dueño[r] = -1;
+        } else {
+            if (pedirTrozo(e->archivo, e->fd, &e->siguienteLectura, e->fin, lector->elementosPorBuffer,
+                           e->buffer, &e->solicitud, &e->inicioBuffer) != 0) {
+                return -1;
+            }
+            if (e->inicioBuffer == SIZE_MAX) {
+                e->posEnBuffer = 0;
+                e->elementosEnBuffer = 0;
+                return 0;
+            }
+            e->esperando = 1;
+            continue;
+        }
+
+        if (recibido < 0) {
+            return -1;
+        }
+        if (recibido == 0) {
+            e->posEnBuffer = 0;
+            e->elementosEnBuffer = 0;
+            continue;
+        }
+        e->datos = e->buffer;
+        if (pronosticar(lector) != 0) {
+            return -1;
+        }
+        return 1;
+    }
 }
 
 /*
-abre un archivo binario con el modo especificado
-archivo: estructura del archivo
-filename: nombre del archivo
-modo: modo de apertura ("rb", "wb", ...)
-return 0 si exito, -1 si error
+cierra una lectura con pronostico: cancela las lecturas pendientes y libera los buffers
 */
-int abrirArchivo(ArchivoBin *archivo, const char *filename, const char *modo) {
-    assert(archivo != NULL && filename != NULL && modo != NULL);
-    
-    //copiar nombre del archivo
-    strncpy(archivo->filename, filename, sizeof(archivo->filename) - 1);
-    archivo->filename[sizeof(archivo->filename) - 1] = '\0';
-    
-    //abrir archivo con el modo especificado
-    archivo->file = fopen(filename, modo);
-    if (!archivo->file) {
+void cerrarLectorPronostico(LectorPronostico *lector) {
+    for (int r = 0; r < PRONOSTICO_RESERVA; r++) {
+        cancelarSolicitud(&lector->solicitudes[r]);
+        free(lector->reserva[r]);
+    }
+    for (int i = 0; i < lector->k && lector->entradas; i++) {
+        EntradaPronostico *e = &lector->entradas[i];
+        cancelarSolicitud(&e->solicitud);
+        free(e->buffer);
+        if (e->fd >= 0) {
+            close(e->fd);
+        }
+    }
+    free(lector->entradas);
+    memset(lector, 0, sizeof(*lector));
+}
+
+//espera una escritura del escritor y revisa que se haya escrito completa
+static int esperarEscritura(SolicitudIO *solicitud) {
+    size_t bytes = solicitud->bytes;
+    long escritos = esperarSolicitud(solicitud);
+    return (escritos < 0 || (size_t)escritos != bytes) ? -1 : 0;
+}
+
+/*
+abre un escritor secuencial que agrega elementos a un archivo abierto desde inicio
+los bloques del pool de ese archivo se escriben y se descartan, desde aqui el
+escritor es el unico que escribe el rango
+escritor: estructura del escritor
+archivo: archivo abierto para escritura
+inicio: posicion del primer elemento a escribir
+bloquesPorBuffer: bloques que se juntan en cada escritura
+return: 0 si exito, -1 si error
+*/
+int abrirEscritor(EscritorSecuencial *escritor, ArchivoBin *archivo, size_t inicio,
+                  size_t bloquesPorBuffer) {
+    memset(escritor, 0, sizeof(*escritor));
+    escritor->archivo = archivo;
+    escritor->fd = -1;
+    if (bloquesPorBuffer < 1) bloquesPorBuffer = 1;
+    escritor->elementosPorBuffer = bloquesPorBuffer * archivo->elementosBloque;
+    if (!dentroDeVista(archivo, inicio, 0)) {
         return -1;
     }
-    
-    //alocar buffer de tamaño B en memoria principal
-    archivo->buffer = malloc(BLOCK_SIZE);
-    if (!archivo->buffer) {
-        fclose(archivo->file);
+    inicio += archivo->desplazamiento;
+    escritor->limite = (archivo->largoVista == SIZE_MAX) ? SIZE_MAX :
+                       archivo->desplazamiento + archivo->largoVista;
+
+    //el buffer parte en un bloque completo, lo anterior a inicio se salta
+    escritor->inicioBuffer = inicio / archivo->elementosBloque * archivo->elementosBloque;
+    escritor->desde = inicio - escritor->inicioBuffer;
+    escritor->usados = escritor->desde;
+
+    for (int b = 0; b < 2; b++) {
+        if (posix_memalign((void**)&escritor->buffers[b], ALINEAMIENTO_IO,
+                           escritor->elementosPorBuffer * ELEMENT_SIZE) != 0) {
+            escritor->buffers[b] = NULL;
+            cerrarEscritor(escritor);
+            return -1;
+        }
+    }
+
+    if (archivo->backend == IO_MMAP) {
+        return 0;
+    }
+
+    //lo pendiente en el pool y en stdio se escribe antes de escribir por otro descriptor
+    pthread_mutex_lock(&mutexPool);
+    int pendiente = (liberarMarcosArchivo(archivo) != 0 || (archivo->file && fflush(archivo->file) != 0));
+    pthread_mutex_unlock(&mutexPool);
+    if (pendiente) {
+        cerrarEscritor(escritor);
         return -1;
     }
-    
-    //inicializar estructura
-    archivo->tamañoBuffer = ELEMENTS_PER_BLOCK;
-    archivo->bloqActual = SIZE_MAX;  //indica que no hay bloque cargado
-    archivo->sucio = 0;  //buffer no está modificado
-    
-    //calcular tamaño del archivo si es para lectura
-    if (strchr(modo, 'r') != NULL) {
-        archivo->file_elementos = obtenerTamañoArchivo(filename);
-    } else {
-        archivo->file_elementos = 0;
+    if (archivo->file) {
+        contarDescarga(archivo->estadisticas);
     }
-    
+
+    int flags = O_WRONLY;
+#ifdef O_DIRECT
+    if (archivo->backend == IO_DIRECTO) {
+        flags = O_RDWR | O_DIRECT;
+    }
+#endif
+    escritor->fd = open(archivo->filename, flags);
+    if (escritor->fd < 0 && archivo->backend == IO_DIRECTO) {
+        escritor->fd = open(archivo->filename, O_RDWR);
+    }
+    if (escritor->fd < 0) {
+        cerrarEscritor(escritor);
+        return -1;
+    }
+
+    //con O_DIRECT se escriben bloques completos: el comienzo del primero se trae del disco
+    if (archivo->backend == IO_DIRECTO && escritor->desde > 0 &&
+        escritor->inicioBuffer < archivo->file_elementos) {
+        if (pread(escritor->fd, escritor->buffers[0], archivo->tamBloque,
+                  (off_t)(escritor->inicioBuffer * ELEMENT_SIZE)) < 0) {
+            cerrarEscritor(escritor);
+            return -1;
+        }
+    }
+
     return 0;
 }
 
 /*
-cierra un archivo y libera todos los recursos
-archivo: estructura del archivo a cerrar
+entrega el buffer actual al hilo de I/O y sigue con el otro
+si el otro todavia se esta escribiendo se espera a que termine. se puede llamar con
+el buffer a medias: el bloque incompleto sigue en el buffer siguiente
+escritor: escritor secuencial abierto
+return: 0 si exito, -1 si error
 */
-void cerrarArchivo(ArchivoBin *archivo) {
-    if (!archivo) return;
-    
-    //escribir buffer si está sucio antes de cerrar
-    if (archivo->sucio) {
-        escribirBloque(archivo);
+int descargarEscritor(EscritorSecuencial *escritor) {
+    if (escritor->error) {
+        return -1;
     }
-    
-    //liberar buffer de memoria principal
-    if (archivo->buffer) {
-        free(archivo->buffer);
-        archivo->buffer = NULL;
+    size_t validos = escritor->usados - escritor->desde;
+    if (validos == 0) {
+        return 0;
     }
-    
-    //cerrar archivo
-    if (archivo->file) {
-        fclose(archivo->file);
-        archivo->file = NULL;
+
+    ArchivoBin *archivo = escritor->archivo;
+    int64_t *buffer = escritor->buffers[escritor->actual];
+    size_t primero = escritor->inicioBuffer + escritor->desde;
+    size_t fin = escritor->inicioBuffer + escritor->usados;
+    if (fin > escritor->limite) {
+        printf("Error: el escritor pasa del final de la vista de %s\n", archivo->filename);
+        escritor->error = 1;
+        return -1;
+    }
+
+    if (archivo->backend == IO_MMAP) {
+        //el mapa ya es memoria, se copia directamente
+        if (escribirRangoInterno(archivo, primero, validos, buffer + escritor->desde) != 0) {
+            escritor->error = 1;
+            return -1;
+        }
+    } else {
+        int otro = 1 - escritor->actual;
+        if (!solicitudLibre(&escritor->solicitudes[otro]) &&
+            esperarEscritura(&escritor->solicitudes[otro]) != 0) {
+            escritor->error = 1;
+            return -1;
+        }
+
+        SolicitudIO *solicitud = &escritor->solicitudes[escritor->actual];
+        solicitud->fd = escritor->fd;
+        solicitud->esEscritura = 1;
+        if (archivo->backend == IO_DIRECTO) {
+            //bloques completos; si el ultimo queda a medias y el archivo sigue, se completa con el disco
+            size_t bloques = (escritor->usados + archivo->elementosBloque - 1) / archivo->elementosBloque;
+            size_t resto = escritor->usados % archivo->elementosBloque;
+            if (resto != 0) {
+                size_t inicioUltimo = (bloques - 1) * archivo->elementosBloque;
+                memset(buffer + escritor->usados, 0, (archivo->elementosBloque - resto) * ELEMENT_SIZE);
+                if (fin < archivo->file_elementos) {
+                    int64_t *bloque;
+                    if (posix_memalign((void**)&bloque, ALINEAMIENTO_IO, archivo->tamBloque) != 0) {
+                        escritor->error = 1;
+                        return -1;
+                    }
+                    ssize_t r = pread(escritor->fd, bloque, archivo->tamBloque,
+                                      (off_t)((escritor->inicioBuffer + inicioUltimo) * ELEMENT_SIZE));
+                    if (r > 0) {
+                        memcpy(buffer + escritor->usados, bloque + resto, (archivo->elementosBloque - resto) * ELEMENT_SIZE);
+                    }
+                    free(bloque);
+                }
+            }
+            solicitud->destino = buffer;
+            solicitud->bytes = bloques * archivo->tamBloque;
+            solicitud->offset = (off_t)(escritor->inicioBuffer * ELEMENT_SIZE);
+        } else {
+            solicitud->destino = buffer + escritor->desde;
+            solicitud->bytes = validos * ELEMENT_SIZE;
+            solicitud->offset = (off_t)(primero * ELEMENT_SIZE);
+        }
+        if (encolarSolicitud(solicitud) != 0) {
+            escritor->error = 1;
+            return -1;
+        }
+        size_t primerBloque = primero / archivo->elementosBloque;
+        size_t finBloques = (fin - 1) / archivo->elementosBloque + 1;
+        contarTransferencia(archivo->estadisticas, 1, finBloques - primerBloque, solicitud->bytes);
+        contarSalto(archivo->estadisticas, &escritor->siguienteBloque, primerBloque, finBloques);
+    }
+
+    //el archivo crece si se escribe despues de su final
+    if (fin > archivo->file_elementos) {
+        archivo->file_elementos = fin;
+    }
+
+    //el buffer siguiente parte en el bloque de fin, como en abrirEscritor: si una
+    //descarga deja un bloque a medias, su comienzo se copia al buffer siguiente para
+    //que con O_DIRECT se vuelva a escribir completo y en un offset alineado
+    size_t inicioSiguiente = fin / archivo->elementosBloque * archivo->elementosBloque;
+    size_t desde = fin - inicioSiguiente;
+    int siguiente = 1 - escritor->actual;
+    if (desde > 0) {
+        memcpy(escritor->buffers[siguiente], buffer + (inicioSiguiente - escritor->inicioBuffer),
+               desde * ELEMENT_SIZE);
     }
+    escritor->inicioBuffer = inicioSiguiente;
+    escritor->actual = siguiente;
+    escritor->desde = desde;
+    escritor->usados = desde;
+    return 0;
 }
 
 /*
-lee un elemento específico del archivo
-archivo: estructura del archivo
-posicion: posición del elemento (indice)
-elemento: puntero donde almacenar el elemento leido
-return 0 si exito, -1 si error
- */
-int leerElemento(ArchivoBin *archivo, size_t pos, int64_t *elemento) {
-    assert(archivo != NULL && elemento != NULL);
-    
-    //calcular el bloque en que esta el elemento
-    size_t bloqIdx = pos / ELEMENTS_PER_BLOCK;
-    size_t offset_en_bloque = pos % ELEMENTS_PER_BLOCK;
-    
-    //cargar el bloque correspondiente si es necesario
-    if (leerBloque(archivo, bloqIdx) != 0) {
-        return -1;
+agrega n elementos al final de lo escrito por el escritor
+return: 0 si exito, -1 si error
+*/
+int agregarRango(EscritorSecuencial *escritor, const int64_t *src, size_t n) {
+    while (n > 0) {
+        if (escritor->usados == escritor->elementosPorBuffer && descargarEscritor(escritor) != 0) {
+            return -1;
+        }
+        size_t cantidad = escritor->elementosPorBuffer - escritor->usados;
+        if (cantidad > n) {
+            cantidad = n;
+        }
+        memcpy(escritor->buffers[escritor->actual] + escritor->usados, src, cantidad * ELEMENT_SIZE);
+        escritor->usados += cantidad;
+        src += cantidad;
+        n -= cantidad;
     }
-    
-    //leer el elemento del buffer en memoria
-    *elemento = archivo->buffer[offset_en_bloque];
     return 0;
 }
 
 /*
-Escribe un elemento específico en el archivo
-archivo: estructura del archivo
-pos: posición donde escribir el elemento
-elemento: elemento a escribir
-return 0 si exito, -1 si error
- */
-int escribirElemento(ArchivoBin *archivo, size_t pos, int64_t elemento) {
-    assert(archivo != NULL);
-    
-    //calcular en que bloque esta el elemento
-    size_t bloque_num = pos / ELEMENTS_PER_BLOCK;
-    size_t offset_en_bloque = pos % ELEMENTS_PER_BLOCK;
-    
-    //cargar el bloque si es necesario
-    if (leerBloque(archivo, bloque_num) != 0) {
-        return -1;
+escribe lo que queda en el escritor, espera sus escrituras pendientes y lo cierra
+(el ArchivoBin sigue abierto y se cierra aparte)
+return: 0 si exito, -1 si hubo algun error de escritura
+*/
+int cerrarEscritor(EscritorSecuencial *escritor) {
+    int resultado = 0;
+    int abierto = escritor->buffers[0] && escritor->buffers[1] &&
+                  (escritor->fd >= 0 || escritor->archivo->backend == IO_MMAP);
+    if (abierto && descargarEscritor(escritor) != 0) {
+        resultado = -1;
     }
-    
-    //escribir el elemento en el buffer de memoria
-    archivo->buffer[offset_en_bloque] = elemento;
-    archivo->bloqActual = bloque_num;
-    archivo->sucio = 1;  //marcar buffer como modificado
-    
-    return 0;
+    for (int b = 0; b < 2; b++) {
+        if (!solicitudLibre(&escritor->solicitudes[b]) &&
+            esperarEscritura(&escritor->solicitudes[b]) != 0) {
+            resultado = -1;
+        }
+        free(escritor->buffers[b]);
+        escritor->buffers[b] = NULL;
+    }
+    if (escritor->fd >= 0) {
+        close(escritor->fd);
+        escritor->fd = -1;
+    }
+    if (escritor->error) {
+        resultado = -1;
+    }
+    return resultado;
 }
 
 /*
@@ -243,4 +2306,50 @@ size_t obtenerTamañoArchivo(const char *filename) {
     return bytes / ELEMENT_SIZE;
 }
 
+/*
+deja un archivo con numElementos elementos (en cero si es nuevo), para que varios
+escritores lo llenen por partes sin que ninguno tenga que agrandarlo
+filename: nombre del archivo
+numElementos: tamaño en elementos
+return: 0 si exito, -1 si error
+*/
+int reservarArchivo(const char *filename, size_t numElementos) {
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    int resultado = (ftruncate(fd, (off_t)(numElementos * ELEMENT_SIZE)) != 0) ? -1 : 0;
+    close(fd);
+    return resultado;
+}
+
+/*
+escribe al dispositivo lo que un archivo cerrado tenga en la cache de paginas y le
+pide al kernel que la descarte, para que la siguiente lectura llegue al disco
+filename: nombre del archivo
+return: 0 si exito, -1 si error
+*/
+int descartarCache(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    int resultado = (fsync(fd) != 0 || posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) != 0) ? -1 : 0;
+    close(fd);
+    return resultado;
+}
+
+static int contadorTemporales = 0;
 
+/*
+arma el nombre de un archivo temporal que no se repite dentro del proceso (ni entre
+procesos): temp_<tipo>_<pid>_<n>.bin, asi los niveles de recursion y los hilos no
+pisan los temporales de otros
+nombre: donde dejar el nombre
+tam: bytes disponibles en nombre
+tipo: quien usa el temporal ("run", "quick", ...)
+*/
+void nombreTemporal(char *nombre, size_t tam, const char *tipo) {
+    int numero = __atomic_fetch_add(&contadorTemporales, 1, __ATOMIC_RELAXED);
+    snprintf(nombre, tam, "temp_%s_%ld_%d.bin", tipo, (long)getpid(), numero);
+}
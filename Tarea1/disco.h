@@ -4,37 +4,278 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <sys/types.h>
 
-#define BLOCK_SIZE 4096                //4kb por bloque
+#define BLOCK_SIZE 4096                //4kb por bloque (B por defecto)
 #define ELEMENT_SIZE sizeof(int64_t)   //8 bytes por elemento
 #define ELEMENTS_PER_BLOCK (BLOCK_SIZE/ELEMENT_SIZE)  //elementos por bloque
-#define MEMORY_LIMIT (50 * 1024 * 1024)  //limite de 50MB
+#define MEMORY_LIMIT (50 * 1024 * 1024)  //limite de 50MB (M por defecto)
+#define FRACCION_POOL 32  //el pool de bloques usa M / FRACCION_POOL
+#define POOL_MEMORY (MEMORY_LIMIT / FRACCION_POOL)  //parte de M reservada al pool de bloques
+#define MEMORIA_TRABAJO (MEMORY_LIMIT - POOL_MEMORY)  //memoria para los arreglos de los algoritmos
+#define COPIA_BLOQUES 256  //bloques de BLOCK_SIZE por trozo al copiar o concatenar datos entre archivos
+#define ALINEAMIENTO_IO 4096  //alineamiento de buffers y offsets para IO_DIRECTO
+#define LECTOR_PROFUNDIDAD 4  //buffers en vuelo por lector secuencial
+#define LECTOR_BLOQUES 16  //bloques por buffer al recorrer una entrada completa
+#define ESCRITOR_BLOQUES 256  //bloques por escritura agrupada (1MB) de un escritor secuencial
+#define PRONOSTICO_RESERVA 2  //buffers de reserva para leer por adelantado en una mezcla con pronostico
+
+//backends de almacenamiento para ArchivoBin
+typedef enum {
+    IO_STDIO,  //fopen/fread/fwrite a traves del pool de bloques
+    IO_MMAP,   //archivo mapeado en memoria con mmap/msync
+    IO_DIRECTO //O_DIRECT (sin page cache) con bloques alineados, a traves del pool
+} TipoIO;
+
+//estadisticas de I/O de una operacion; se actualizan con operaciones atomicas,
+//asi un mismo contexto se puede compartir entre archivos usados por varios hilos
+typedef struct {
+    long long lecturas;      //bloques leidos desde disco
+    long long escrituras;    //bloques escritos a disco
+    long long bytesLeidos;
+    long long bytesEscritos;
+    long long saltos;        //accesos que no siguen al anterior del mismo flujo (seeks)
+    long long descargas;     //fflush/msync que bajan a disco lo pendiente de un archivo
+} EstadisticasIO;
+
+//opciones al abrir un archivo
+typedef struct {
+    TipoIO backend;
+    size_t tamBloque; //B en bytes, 0 para usar BLOCK_SIZE
+    EstadisticasIO *estadisticas; //donde se cuentan sus accesos, NULL para el contexto global
+} OpcionesArchivo;
 
 typedef struct{
+    TipoIO backend;
     FILE *file;
-    int64_t *buffer;
+    int64_t *buffer; //datos del bloque actual (apunta a un marco del pool)
     size_t tamañoBuffer;
+    size_t tamBloque; //B de este archivo en bytes
+    size_t elementosBloque; //elementos por bloque (B / ELEMENT_SIZE)
     size_t bloqActual;
-    int sucio ; //indica si buffer ha sido modificado pero aun no se escribe en disco (si está 'sucio')
+    int marco; //indice del marco del pool que tiene el bloque actual, -1 si ninguno
+    long long id; //identificador unico del archivo abierto dentro del pool
     char filename[256];
-    size_t file_elementos; //tamaño del archivo en elementos
+    size_t file_elementos; //tamaño logico del archivo completo en elementos
+    size_t desplazamiento; //vista: elemento del archivo completo que es la posicion 0
+    size_t largoVista; //vista: elementos que abarca, SIZE_MAX si es el archivo completo
+    EstadisticasIO *estadisticas; //contexto donde se cuentan sus accesos
+    size_t siguienteBloque; //bloque que sigue al ultimo acceso (para contar saltos)
+
+    //backends IO_MMAP e IO_DIRECTO
+    int fd;
+    int64_t *mapa; //archivo mapeado, NULL si aun no tiene tamaño
+    size_t capacidad; //elementos mapeados (puede ser mayor que file_elementos)
+    unsigned char *estadoBloques; //por bloque: BLOQUE_LEIDO / BLOQUE_ESCRITO
+    size_t numEstados;
+    int escritura; //se abrio en un modo que permite escribir
 
 } ArchivoBin;
 
+//estados de una solicitud al motor de I/O asincrono
+typedef enum {
+    SOLICITUD_LIBRE,
+    SOLICITUD_PENDIENTE, //en la cola, aun no la toma el hilo de I/O
+    SOLICITUD_EN_CURSO,
+    SOLICITUD_LISTA
+} EstadoSolicitud;
+
+//lectura o escritura que hace el hilo de I/O en segundo plano
+typedef struct SolicitudIO {
+    int fd;
+    int esEscritura;
+    void *destino; //buffer de datos (origen si es escritura)
+    size_t bytes;
+    off_t offset;
+    long resultado; //bytes leidos o escritos, -1 si error
+    EstadoSolicitud estado;
+    struct SolicitudIO *siguiente;
+} SolicitudIO;
+
+//lector secuencial con lectura anticipada: mantiene varios buffers pedidos
+//al hilo de I/O mientras se consume el actual
+typedef struct {
+    ArchivoBin *archivo;
+    int fd; //descriptor propio para leer desde el hilo de I/O, -1 si el archivo esta mapeado
+    int numBuffers;
+    size_t elementosPorBuffer;
+    int64_t **buffers;
+    SolicitudIO *solicitudes;
+    size_t *inicioBuffer; //posicion en el archivo del primer elemento de cada buffer
+    size_t inicio;
+    size_t fin; //posicion final (exclusiva) del rango a leer
+    size_t siguienteLectura; //posicion del proximo buffer a pedir
+    int actual; //buffer que se esta consumiendo
+    const int64_t *datos; //elementos disponibles del buffer actual
+    size_t posEnBuffer;
+    size_t elementosEnBuffer;
+    size_t siguienteBloque; //bloque que sigue al ultimo buffer recibido (para contar saltos)
+} LectorSecuencial;
+
+//escritor secuencial (solo agrega al final): junta bloques consecutivos en
+//escrituras grandes que el hilo de I/O hace mientras se llena el otro buffer
+typedef struct {
+    ArchivoBin *archivo;
+    int fd; //descriptor propio, -1 si el archivo esta mapeado
+    int64_t *buffers[2];
+    SolicitudIO solicitudes[2];
+    int actual; //buffer que se esta llenando
+    size_t elementosPorBuffer;
+    size_t inicioBuffer; //posicion en el archivo del elemento 0 del buffer actual
+    size_t desde; //primer elemento valido del buffer actual
+    size_t usados; //elementos llenados del buffer actual (incluye el desplazamiento inicial)
+    size_t limite; //posicion final (exclusiva) que se puede escribir: el fin de la vista
+    int error;
+    size_t siguienteBloque; //bloque que sigue a la ultima escritura (para contar saltos)
+} EscritorSecuencial;
+
+//entrada de una lectura con pronostico: un solo buffer que se consume, y a lo mas
+//un trozo siguiente leido por adelantado en un buffer de la reserva
+typedef struct {
+    ArchivoBin *archivo;
+    int fd; //descriptor propio, -1 si el archivo esta mapeado o el rango vacio
+    size_t inicio;
+    size_t fin; //posicion final (exclusiva) del rango a leer
+    size_t siguienteLectura; //posicion del proximo trozo a pedir
+    int64_t *buffer;
+    SolicitudIO solicitud; //primera lectura, o la de un trozo que no se pronostico
+    size_t inicioBuffer; //posicion del trozo pedido en buffer, SIZE_MAX si no hay
+    int esperando; //el trozo de buffer aun no se recibe
+    int adelantado; //buffer de la reserva con el trozo siguiente, -1 si no hay
+    const int64_t *datos; //elementos disponibles del buffer actual
+    size_t posEnBuffer;
+    size_t elementosEnBuffer;
+    size_t siguienteBloque; //bloque que sigue al ultimo trozo recibido (para contar saltos)
+} EntradaPronostico;
+
+//lectura de las k entradas de una mezcla con pronostico (forecasting, Knuth 5.4.6):
+//en vez de que cada entrada tenga lectura anticipada propia, unos pocos buffers de
+//reserva leen el trozo siguiente de la entrada cuyo buffer termina con la menor
+//clave, que es la que la mezcla va a agotar primero
+typedef struct {
+    EntradaPronostico *entradas;
+    int k;
+    size_t elementosPorBuffer;
+    int64_t *reserva[PRONOSTICO_RESERVA];
+    SolicitudIO solicitudes[PRONOSTICO_RESERVA];
+    size_t inicioReserva[PRONOSTICO_RESERVA]; //posicion del trozo leido en cada buffer
+    int dueño[PRONOSTICO_RESERVA]; //entrada para la que se leyo cada buffer, -1 si esta libre
+} LectorPronostico;
+
 //funciones principales
 void contadorACero();
 long long obtenerAccesos();
+EstadisticasIO *estadisticasGlobales(void);
+void estadisticasACero(EstadisticasIO *io);
+void copiarEstadisticas(const EstadisticasIO *io, EstadisticasIO *copia);
+void restarEstadisticas(const EstadisticasIO *fin, const EstadisticasIO *inicio, EstadisticasIO *diferencia);
+long long accesosTotales(const EstadisticasIO *io);
+void sumarEstadisticas(EstadisticasIO *destino, const EstadisticasIO *io);
 int leerBloque(ArchivoBin *archivo, size_t bloqIdx);
 int escribirBloque(ArchivoBin *archivo);
 int cargarEnMemoria(ArchivoBin *archivo, size_t bloqIdx);
 
+//pool de bloques compartido
+int configurarPool(size_t memoria, size_t tamBloque);
+size_t obtenerMarcosPool(void);
+size_t bloquesDeTrozo(size_t tamBloque, size_t bloques);
+
 //auxiliares
 int abrirArchivo(ArchivoBin *archivo, const char *filename, const char *modo);
+int abrirArchivoCon(ArchivoBin *archivo, const char *filename, const char *modo,
+                    const OpcionesArchivo *opciones);
+void establecerBackendPorDefecto(TipoIO backend);
+TipoIO obtenerBackendPorDefecto(void);
 void cerrarArchivo(ArchivoBin *archivo);
+
+//vista de [inicio, inicio + numElementos) de un archivo: las posiciones de leer,
+//escribir, lectores y escritores son relativas a inicio, sin copiar el rango
+int abrirVista(ArchivoBin *vista, const char *filename, const char *modo, size_t inicio, size_t numElementos,
+               const OpcionesArchivo *opciones);
+size_t elementosArchivo(const ArchivoBin *archivo);
 int leerElemento(ArchivoBin *archivo, size_t pos, int64_t *elemento);
 int escribirElemento(ArchivoBin *archivo, size_t pos, int64_t elemento);
 
+//lectura y escritura de rangos completos
+int leerRango(ArchivoBin *archivo, size_t pos, size_t n, int64_t *dst);
+int escribirRango(ArchivoBin *archivo, size_t pos, size_t n, const int64_t *src);
+
+//lectura secuencial anticipada
+int abrirLector(LectorSecuencial *lector, ArchivoBin *archivo, size_t inicio, size_t fin,
+                int numBuffers, size_t bloquesPorBuffer);
+int avanzarLector(LectorSecuencial *lector);
+long leerSiguientes(LectorSecuencial *lector, size_t n, int64_t *dst);
+void cerrarLector(LectorSecuencial *lector);
+
+//lectura con pronostico para mezclas
+int abrirLectorPronostico(LectorPronostico *lector, ArchivoBin *archivos, const size_t *desde,
+                          const size_t *hasta, int k, size_t bloquesPorBuffer);
+int avanzarPronostico(LectorPronostico *lector, int entrada);
+void cerrarLectorPronostico(LectorPronostico *lector);
+
+//escritura secuencial agrupada
+int abrirEscritor(EscritorSecuencial *escritor, ArchivoBin *archivo, size_t inicio,
+                  size_t bloquesPorBuffer);
+int descargarEscritor(EscritorSecuencial *escritor);
+int agregarRango(EscritorSecuencial *escritor, const int64_t *src, size_t n);
+int cerrarEscritor(EscritorSecuencial *escritor);
+int sincronizarArchivo(ArchivoBin *archivo);
+void detenerMotorIO(void);
+
+/*
+entrega el siguiente elemento del lector
+lector: lector secuencial abierto
+elemento: donde dejar el elemento
+return: 1 si se entrego un elemento, 0 si se llego al final, -1 si error
+*/
+static inline int siguienteElemento(LectorSecuencial *lector, int64_t *elemento) {
+    if (lector->posEnBuffer >= lector->elementosEnBuffer) {
+        int r = avanzarLector(lector);
+        if (r <= 0) {
+            return r;
+        }
+    }
+    *elemento = lector->datos[lector->posEnBuffer++];
+    return 1;
+}
+
+/*
+agrega un elemento al final de lo escrito por el escritor
+escritor: escritor secuencial abierto
+elemento: elemento a escribir
+return: 0 si exito, -1 si error
+*/
+static inline int agregarElemento(EscritorSecuencial *escritor, int64_t elemento) {
+    if (escritor->usados == escritor->elementosPorBuffer && descargarEscritor(escritor) != 0) {
+        return -1;
+    }
+    escritor->buffers[escritor->actual][escritor->usados++] = elemento;
+    return 0;
+}
+
+/*
+entrega el siguiente elemento de una entrada de la lectura con pronostico
+lector: lectura con pronostico abierta
+entrada: entrada de donde leer
+elemento: donde dejar el elemento
+return: 1 si se entrego un elemento, 0 si la entrada se termino, -1 si error
+*/
+static inline int siguientePronostico(LectorPronostico *lector, int entrada, int64_t *elemento) {
+    EntradaPronostico *e = &lector->entradas[entrada];
+    if (e->posEnBuffer >= e->elementosEnBuffer) {
+        int r = avanzarPronostico(lector, entrada);
+        if (r <= 0) {
+            return r;
+        }
+    }
+    *elemento = e->datos[e->posEnBuffer++];
+    return 1;
+}
+
 size_t obtenerTamañoArchivo(const char *filename);
+int reservarArchivo(const char *filename, size_t numElementos);
+int descartarCache(const char *filename);
+void nombreTemporal(char *nombre, size_t tam, const char *tipo);
 
 
 #endif
\ No newline at end of file
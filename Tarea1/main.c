@@ -1,11 +1,17 @@
 #include "disco.h"
+#include "config.h"
 #include "merge.h" 
 #include "quick.h"
 #include "experimento.h"
+#include "simd.h"
+#include "modelo.h"
+#include "perfil.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <dirent.h>
+#include <unistd.h>
 
 //estructura para resultados completos
 typedef struct {
@@ -18,8 +24,24 @@ typedef struct {
     double promedioAccesosQuick;
 } ResultadoCompleto;
 
+//B, M y backend con que corren los experimentos (se pueden cambiar por argumentos)
+static ConfigOrden config;
+
+//ademas del modelo de costo, buscar la aridad corriendo mergesort (para validar el modelo):
+//0 no, 1 busqueda adaptativa, 2 busqueda completa
+static int validarAridad = 0;
+
+//ignorar el perfil guardado y volver a ajustar
+static int reajustar = 0;
+
+//tamaños de bloque que recorre el barrido (bytes)
+static const size_t bloquesBarrido[] = {512, 1024, 4096, 16384, 65536, 262144, 1048576};
+#define NUM_BLOQUES_BARRIDO (sizeof(bloquesBarrido) / sizeof(bloquesBarrido[0]))
+
 //declaraciones de funciones del main
 int ejecutarExperimentosCompletos(void);
+int ejecutarBarridoBloques(size_t N, int aridadPedida);
+int leerTamaño(const char *texto, size_t *valor);
 int encontrarYUsarAridadOptima(void);
 int ejecutarComparacionAlgoritmos(int aridad);
 int calcularPromedios(ResultadoCompleto *resultado);
@@ -62,6 +84,79 @@ int verificarArchivoOrdenado(const char *filename, size_t N) {
 }
 
 int main(int argc, char *argv[]) {
+    size_t tamBloque = BLOCK_SIZE;
+    size_t memoria = MEMORY_LIMIT;
+    size_t nBarrido = 0;
+    size_t aridadBarrido = 0;
+    MotorMemoria motor = MOTOR_COMPARACION;
+    size_t hilos = 1;
+    int aridadPorNivel = 1;
+    int colocacionDirecta = 1;
+
+    //opciones de linea de comandos
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--mmap") == 0) {
+            //todos los archivos usan el backend mapeado en memoria
+            establecerBackendPorDefecto(IO_MMAP);
+        } else if (strcmp(argv[i], "--directo") == 0) {
+            //O_DIRECT: los accesos van al dispositivo y no al page cache
+            establecerBackendPorDefecto(IO_DIRECTO);
+        } else if (strcmp(argv[i], "--radix") == 0) {
+            //los casos base en memoria de ambos algoritmos usan radix sort
+            motor = MOTOR_RADIX;
+        } else if (strncmp(argv[i], "--hilos=", 8) == 0 && leerTamaño(argv[i] + 8, &hilos) == 0) {
+            //hilos para los casos base en memoria
+        } else if (strcmp(argv[i], "--validar-aridad") == 0) {
+            //la aridad del modelo se compara con la de la busqueda corriendo mergesort
+            validarAridad = 1;
+        } else if (strcmp(argv[i], "--validar-aridad=completa") == 0) {
+            //igual, pero probando cada aridad de la busqueda original completa
+            validarAridad = 2;
+        } else if (strcmp(argv[i], "--aridad-fija") == 0) {
+            //todos los niveles usan la aridad elegida, sin adaptarla al tamaño
+            aridadPorNivel = 0;
+        } else if (strcmp(argv[i], "--concatenar") == 0) {
+            //quicksort ordena cada particion en su archivo y despues las concatena
+            colocacionDirecta = 0;
+        } else if (strcmp(argv[i], "--reajustar") == 0) {
+            //se vuelve a calibrar aunque haya un perfil guardado
+            reajustar = 1;
+        } else if (strcmp(argv[i], "--escalar") == 0) {
+            //kernels en memoria escalares aunque la CPU tenga AVX2
+            usarKernelsEscalares(1);
+        } else if (strncmp(argv[i], "--bloque=", 9) == 0 && leerTamaño(argv[i] + 9, &tamBloque) == 0) {
+            //B en bytes
+        } else if (strncmp(argv[i], "--memoria=", 10) == 0 && leerTamaño(argv[i] + 10, &memoria) == 0) {
+            //M en bytes
+        } else if (strncmp(argv[i], "--barrido=", 10) == 0 && leerTamaño(argv[i] + 10, &nBarrido) == 0) {
+            //N en elementos para el barrido de tamaños de bloque
+        } else if (strncmp(argv[i], "--aridad=", 9) == 0 && leerTamaño(argv[i] + 9, &aridadBarrido) == 0) {
+            //aridad fija para el barrido
+        } else {
+            printf("Uso: %s [--mmap | --directo] [--radix] [--hilos=H] [--escalar] [--validar-aridad[=completa]] [--reajustar] [--aridad-fija] [--concatenar] [--bloque=B] [--memoria=M] [--barrido=N [--aridad=A]]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    config = configPorDefecto();
+    config.tamBloque = tamBloque;
+    config.memoria = memoria;
+    config.motor = motor;
+    config.hilos = (int)hilos;
+    config.aridadPorNivel = aridadPorNivel;
+    config.colocacionDirecta = colocacionDirecta;
+    if (validarConfig(&config) != 0) {
+        return 1;
+    }
+    printf("Kernels en memoria: %s\n", kernelsSimdActivos() ? "AVX2" : "escalares");
+
+    if (nBarrido > 0) {
+        //solo el barrido de B, con N y M fijos
+        int resultado = ejecutarBarridoBloques(nBarrido, (int)aridadBarrido);
+        detenerMotorIO();
+        return (resultado == 0) ? 0 : 1;
+    }
+
     //ejecutar experimentos completos
     if (ejecutarExperimentosCompletos() != 0) {
         return 1;
@@ -69,6 +164,7 @@ int main(int argc, char *argv[]) {
     
     //limpiar archivos temporales
     limpiarTemporales();
+    detenerMotorIO();
     
     return 0;
 }
@@ -89,11 +185,38 @@ int ejecutarExperimentosCompletos(void) {
 }
 
 int encontrarYUsarAridadOptima(void) {
-    //usar archivo de 60M para encontrar aridad
-    size_t M = MEMORY_LIMIT / ELEMENT_SIZE;
+    //la aridad se planifica para el archivo de 60M
+    size_t M = config.memoria / ELEMENT_SIZE;
     size_t N_60M = 60 * M;
     
-    //crear archivo de prueba si no existe
+    //perfil guardado de una ejecucion anterior, o modelo de costo calibrado con un
+    //microbenchmark (validar siempre vuelve a medir)
+    struct timespec inicio;
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    PerfilAjuste perfil;
+    int aridad = aridadAjustada(&config, N_60M, reajustar || validarAridad, &perfil);
+    if (aridad < 0) {
+        return -1;
+    }
+    const CalibracionCosto *calibracion = &perfil.calibracion;
+    printf("Calibracion%s: %.3g s por solicitud, %.3g s por bloque (%.1f MB/s), %.3g s por comparacion, "
+           "%.3g s por nivel de heap\n", perfil.guardado ? " (perfil guardado)" : "",
+           calibracion->segundosPorSolicitud, calibracion->segundosPorBloque,
+           (calibracion->segundosPorBloque > 0) ? config.tamBloque / calibracion->segundosPorBloque / (1024 * 1024) : 0,
+           calibracion->segundosPorComparacion, calibracion->segundosPorNivelHeap);
+    
+    PrediccionCosto merge, quick;
+    predecirMergesort(&config, N_60M, aridad, calibracion, &merge);
+    predecirQuicksort(&config, N_60M, aridad, calibracion, &quick);
+    printf("=== Aridad %s: %d (%s, %.3f ms) ===\n", perfil.guardado ? "del perfil" : "planificada", aridad, perfil.origen,
+           1000.0 * segundosRealesDesde(&inicio));
+    printf("Prediccion mergesort: %.3f seg, %.0f accesos, %d pasadas\n", merge.segundos, merge.accesos, merge.niveles);
+    printf("Prediccion quicksort: %.3f seg, %.0f accesos, %d niveles\n", quick.segundos, quick.accesos, quick.niveles);
+    if (!validarAridad) {
+        return aridad;
+    }
+    
+    //validacion: busqueda corriendo mergesort sobre el archivo de 60M
     char *archivoTest = generarNombreSecuencia(N_60M, 0);
     
     if (obtenerTamañoArchivo(archivoTest) != N_60M) {
@@ -103,15 +226,26 @@ int encontrarYUsarAridadOptima(void) {
         }
     }
     
-    //encontrar aridad optima
-    int aridad = encontrarAridadOptima(archivoTest, N_60M);
-    
+    int aridadBusqueda = (validarAridad == 2) ? encontrarAridadOptimaCon(archivoTest, N_60M, &config)
+                                              : buscarAridadAdaptativaCon(archivoTest, N_60M, &config);
     free(archivoTest);
+    if (aridadBusqueda > 0) {
+        PrediccionCosto prediccionBusqueda;
+        predecirMergesort(&config, N_60M, aridadBusqueda, calibracion, &prediccionBusqueda);
+        printf("Validacion: la busqueda eligio %d (prediccion %.3f seg, %.0f accesos), el modelo %d\n",
+               aridadBusqueda, prediccionBusqueda.segundos, prediccionBusqueda.accesos, aridad);
+
+        //la aridad medida queda en el perfil para las ejecuciones siguientes
+        perfil.aridad = aridadBusqueda;
+        snprintf(perfil.origen, sizeof(perfil.origen), "busqueda");
+        guardarPerfil(ARCHIVO_PERFIL, &perfil);
+        aridad = aridadBusqueda;
+    }
     return aridad;
 }
 
 int ejecutarComparacionAlgoritmos(int aridad) {
-    size_t M = MEMORY_LIMIT / ELEMENT_SIZE;
+    size_t M = config.memoria / ELEMENT_SIZE;
     
     for (int multiplicador = 4; multiplicador <= 60; multiplicador += 4) {
         size_t N = multiplicador * M;
@@ -142,8 +276,8 @@ int ejecutarComparacionAlgoritmos(int aridad) {
             snprintf(archivoSalidaMerge, sizeof(archivoSalidaMerge), 
                      "resultado_merge_%d_%d.bin", multiplicador, secuencia);
             
-            if (mergesortExterno(archivo, archivoSalidaMerge, N, aridad, 
-                                &resultado.statsMerge[secuencia]) != 0) {
+            if (mergesortExternoCon(archivo, archivoSalidaMerge, N, aridad, &config,
+                                    &resultado.statsMerge[secuencia]) != 0) {
                 free(archivo);
                 return -1;
             }
@@ -160,8 +294,8 @@ int ejecutarComparacionAlgoritmos(int aridad) {
             snprintf(archivoSalidaQuick, sizeof(archivoSalidaQuick),
                      "resultado_quick_%d_%d.bin", multiplicador, secuencia);
             
-            if (quicksortExterno(archivo, archivoSalidaQuick, N, aridad,
-                                &resultado.statsQuick[secuencia]) != 0) {
+            if (quicksortExternoCon(archivo, archivoSalidaQuick, N, aridad, &config,
+                                    &resultado.statsQuick[secuencia]) != 0) {
                 free(archivo);
                 return -1;
             }
@@ -228,7 +362,7 @@ int guardarResultadoIndividualCSV(ResultadoCompleto *resultado, int esElPrimero)
     }
     
     //escribir datos de este N
-    size_t M = MEMORY_LIMIT / ELEMENT_SIZE;
+    size_t M = config.memoria / ELEMENT_SIZE;
     int multiplicador = resultado->N / M;
     double razonTiempo = resultado->promedioTiempoMerge / resultado->promedioTiempoQuick;
     double razonAccesos = resultado->promedioAccesosMerge / resultado->promedioAccesosQuick;
@@ -245,6 +379,99 @@ int guardarResultadoIndividualCSV(ResultadoCompleto *resultado, int esElPrimero)
     return 0;
 }
 
+/*
+barrido de tamaños de bloque: ordena la misma entrada de N elementos con cada B de
+bloquesBarrido (M fijo) y guarda tiempo y accesos de ambos algoritmos
+N: cantidad de elementos de la entrada
+aridadPedida: aridad a usar, 0 para usar la maxima que permite cada B
+return: 0 si exito, -1 si error
+*/
+int ejecutarBarridoBloques(size_t N, int aridadPedida) {
+    char archivo[256];
+    snprintf(archivo, sizeof(archivo), "secuencia_barrido_%zu.bin", N);
+    if (obtenerTamañoArchivo(archivo) != N && generarSecuenciaAleatoria(archivo, N) != 0) {
+        return -1;
+    }
+
+    FILE *csv = fopen("resultados_bloques.csv", "w");
+    if (!csv) {
+        return -1;
+    }
+    fprintf(csv, "B,N_Elementos,M,Aridad,Merge_Tiempo,Quick_Tiempo,Merge_Accesos,Quick_Accesos,");
+    fprintf(csv, "Merge_MB_Transferidos,Quick_MB_Transferidos\n");
+
+    for (size_t i = 0; i < NUM_BLOQUES_BARRIDO; i++) {
+        ConfigOrden cfg = config;
+        cfg.tamBloque = bloquesBarrido[i];
+        if (validarConfig(&cfg) != 0) {
+            printf("B = %zu no se puede usar con esta configuracion, se omite\n", cfg.tamBloque);
+            continue;
+        }
+
+        int aridad = calcularMaxAridad(&cfg);
+        if (aridadPedida > 0 && aridadPedida < aridad) {
+            aridad = aridadPedida;
+        }
+        printf("=== Barrido: B = %zu, aridad %d ===\n", cfg.tamBloque, aridad);
+
+        EstadisticasMerge statsMerge;
+        EstadisticasQuick statsQuick;
+        int correcto = mergesortExternoCon(archivo, "resultado_barrido_merge.bin", N, aridad, &cfg, &statsMerge) == 0 &&
+                       verificarArchivoOrdenado("resultado_barrido_merge.bin", N) == 1 &&
+                       quicksortExternoCon(archivo, "resultado_barrido_quick.bin", N, aridad, &cfg, &statsQuick) == 0 &&
+                       verificarArchivoOrdenado("resultado_barrido_quick.bin", N) == 1;
+        remove("resultado_barrido_merge.bin");
+        remove("resultado_barrido_quick.bin");
+        limpiarTemporales();
+        if (!correcto) {
+            //un B no soportado no invalida el resto del barrido
+            printf("Error ordenando con B = %zu, se omite\n", cfg.tamBloque);
+            continue;
+        }
+
+        //con B distinto un acceso mueve distinta cantidad de bytes
+        double mbMerge = (double)(statsMerge.io.bytesLeidos + statsMerge.io.bytesEscritos) / (1024.0 * 1024.0);
+        double mbQuick = (double)(statsQuick.io.bytesLeidos + statsQuick.io.bytesEscritos) / (1024.0 * 1024.0);
+        fprintf(csv, "%zu,%zu,%zu,%d,%.6f,%.6f,%lld,%lld,%.1f,%.1f\n",
+                cfg.tamBloque, N, cfg.memoria, aridad,
+                statsMerge.tiempoEjecucion, statsQuick.tiempoEjecucion,
+                statsMerge.accesosdisco, statsQuick.accesosdisco, mbMerge, mbQuick);
+        fflush(csv);
+    }
+
+    fclose(csv);
+    return 0;
+}
+
+/*
+lee un tamaño de la linea de comandos, acepta sufijos k, m y g (potencias de 1024)
+texto: texto a leer
+valor: donde dejar el tamaño
+return: 0 si exito, -1 si el texto no es un tamaño valido
+*/
+int leerTamaño(const char *texto, size_t *valor) {
+    char *fin;
+    unsigned long long numero = strtoull(texto, &fin, 10);
+    if (fin == texto) {
+        return -1;
+    }
+    if (*fin == 'k' || *fin == 'K') {
+        numero *= 1024ULL;
+        fin++;
+    } else if (*fin == 'm' || *fin == 'M') {
+        numero *= 1024ULL * 1024;
+        fin++;
+    } else if (*fin == 'g' || *fin == 'G') {
+        numero *= 1024ULL * 1024 * 1024;
+        fin++;
+    }
+    if (*fin != '\0' || numero == 0) {
+        return -1;
+    }
+    *valor = (size_t)numero;
+    return 0;
+}
+
 char* generarNombreSecuencia(size_t N, int secuencia) {
     char *nombre = malloc(256);
     snprintf(nombre, 256, "secuencia_%zu_%d.bin", N, secuencia);
@@ -255,20 +482,27 @@ void limpiarTemporales(void) {
     //limpiar archivos conocidos
     char nombreArchivo[256];
     
-    //limpiar archivos de subarchivos temporales (temp_sub_X.bin)
-    for (int i = 0; i < 100; i++) {
-        snprintf(nombreArchivo, sizeof(nombreArchivo), "temp_sub_%d.bin", i);
-        remove(nombreArchivo);
-    }
-    
-    //limpiar archivos de quicksort temporales (temp_quick_X.bin)
-    for (int i = 0; i < 100; i++) {
-        snprintf(nombreArchivo, sizeof(nombreArchivo), "temp_quick_%d.bin", i);
-        remove(nombreArchivo);
+    //limpiar temporales de ambos algoritmos (temp_<tipo>_<pid>_<n>.bin), solo los de
+    //este proceso: los de otro que ordena en el mismo directorio siguen en uso
+    char marca[32];
+    snprintf(marca, sizeof(marca), "_%ld_", (long)getpid());
+    DIR *directorio = opendir(".");
+    if (directorio) {
+        struct dirent *entrada;
+        while ((entrada = readdir(directorio)) != NULL) {
+            size_t largo = strlen(entrada->d_name);
+            if (strncmp(entrada->d_name, "temp_", 5) == 0 && largo > 4 &&
+                strstr(entrada->d_name + 5, marca) != NULL &&
+                strcmp(entrada->d_name + largo - 4, ".bin") == 0) {
+                remove(entrada->d_name);
+            }
+        }
+        closedir(directorio);
     }
     
     //limpiar archivos de prueba de aridad
-    for (int i = 2; i <= ELEMENTS_PER_BLOCK; i++) {
+    int maxAridad = calcularMaxAridad(&config);
+    for (int i = 2; i <= maxAridad; i++) {
         snprintf(nombreArchivo, sizeof(nombreArchivo), "copia_prueba_%d.bin", i);
         remove(nombreArchivo);
         snprintf(nombreArchivo, sizeof(nombreArchivo), "salida_prueba_%d.bin", i);
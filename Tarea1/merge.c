@@ -1,11 +1,103 @@
 #include "merge.h"
+#include "simd.h"
+#include "paralelo.h"
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <math.h>
 
+//nodo del arbol de perdedores: la clave va junto a su entrada para que cada
+//comparacion lea un solo nodo contiguo
+typedef struct {
+    int64_t clave;
+    int fuente; //entrada de donde viene la clave, >= k si esa entrada ya se agoto
+} NodoTorneo;
+
+//arbol de perdedores (tournament tree) para el merge de k-vias
+//nodos[0] tiene al ganador y nodos[1..k-1] al perdedor de cada partido; la hoja
+//de la entrada i esta en la posicion k + i, y su padre en (k + i) / 2
+typedef struct {
+    NodoTorneo *nodos;
+    int k;
+} ArbolPerdedores;
+
+//a gana a b si tiene menor clave; con claves iguales gana la entrada menor, y las
+//entradas agotadas (fuente >= k, clave INT64_MAX) pierden contra cualquier real
+static inline int ganaTorneo(NodoTorneo a, NodoTorneo b) {
+    return a.clave < b.clave || (a.clave == b.clave && a.fuente < b.fuente);
+}
+
+//nodo centinela de una entrada agotada
+static inline NodoTorneo nodoAgotado(const ArbolPerdedores *arbol, int fuente) {
+    NodoTorneo nodo = {INT64_MAX, arbol->k + fuente};
+    return nodo;
+}
+
+/*
+arma el arbol jugando todos los partidos desde las hojas
+arbol: arbol a crear
+hojas: primer elemento de cada entrada (las agotadas con nodoAgotado)
+k: cantidad de entradas
+return: 0 si exito, -1 si error
+*/
+static int crearArbolPerdedores(ArbolPerdedores *arbol, const NodoTorneo *hojas, int k) {
+    arbol->k = k;
+    arbol->nodos = NULL;
+    if (k < 1) {
+        return -1;
+    }
+    arbol->nodos = malloc(k * sizeof(NodoTorneo));
+    NodoTorneo *ganadores = malloc(2 * k * sizeof(NodoTorneo));
+    if (!arbol->nodos || !ganadores) {
+        free(arbol->nodos);
+        free(ganadores);
+        arbol->nodos = NULL;
+        return -1;
+    }
+
+    for (int i = 0; i < k; i++) {
+        ganadores[k + i] = hojas[i];
+    }
+    for (int n = k - 1; n >= 1; n--) {
+        NodoTorneo a = ganadores[2 * n];
+        NodoTorneo b = ganadores[2 * n + 1];
+        if (ganaTorneo(a, b)) {
+            ganadores[n] = a;
+            arbol->nodos[n] = b;
+        } else {
+            ganadores[n] = b;
+            arbol->nodos[n] = a;
+        }
+    }
+    arbol->nodos[0] = ganadores[1]; //con k = 1 es la unica hoja
+
+    free(ganadores);
+    return 0;
+}
+
+/*
+reemplaza al ganador por el siguiente elemento de su misma entrada y juega solo
+los partidos del camino a la raiz (log2(k) comparaciones)
+arbol: arbol de perdedores
+nuevo: siguiente elemento de la entrada ganadora, o su nodoAgotado
+*/
+static inline void reemplazarGanador(ArbolPerdedores *arbol, NodoTorneo nuevo) {
+    int fuente = arbol->nodos[0].fuente;
+    if (fuente >= arbol->k) {
+        fuente -= arbol->k;
+    }
+    for (int p = (arbol->k + fuente) >> 1; p >= 1; p >>= 1) {
+        if (ganaTorneo(arbol->nodos[p], nuevo)) {
+            NodoTorneo perdedor = nuevo;
+            nuevo = arbol->nodos[p];
+            arbol->nodos[p] = perdedor;
+        }
+    }
+    arbol->nodos[0] = nuevo;
+}
+
 /*
-implementa merge externo principal
+implementa merge externo principal con B y M por defecto
 archivoEntrada: archivo binario con datos desordenados
 archivoSalida: archivo binario donde guardar resultado ordenado
 numElementos: cantidad de elementos en el archivo
@@ -15,343 +107,1104 @@ return: 0 si exito, -1 si error
 */
 int mergesortExterno(const char *archivoEntrada, const char *archivoSalida, 
                      size_t numElementos, int aridad, EstadisticasMerge *stats) {
+    ConfigOrden cfg = configPorDefecto();
+    return mergesortExternoCon(archivoEntrada, archivoSalida, numElementos, aridad, &cfg, stats);
+}
+
+/*
+implementa merge externo principal con un B y un M dados
+archivoEntrada: archivo binario con datos desordenados
+archivoSalida: archivo binario donde guardar resultado ordenado
+numElementos: cantidad de elementos en el archivo
+aridad: numero de subarchivos a crear (aridad del merge)
+cfg: tamaño de bloque, memoria y backend
+stats: estructura para guardar estadisticas
+return: 0 si exito, -1 si error
+*/
+int mergesortExternoCon(const char *archivoEntrada, const char *archivoSalida, 
+                        size_t numElementos, int aridad, const ConfigOrden *cfg,
+                        EstadisticasMerge *stats) {
     
-    contadorACero();
-    clock_t inicio = clock();
+    if (prepararConfig(cfg) != 0) {
+        return -1;
+    }
+
+    //los accesos se cuentan en el contexto de quien llama, o en uno propio si no se
+    //dio ninguno
+    ConfigOrden cfgPropia;
+    EstadisticasIO ioPropio;
+    cfg = configConEstadisticas(cfg, &cfgPropia, &ioPropio);
+    EstadisticasIO ioInicio;
+    copiarEstadisticas(cfg->estadisticas, &ioInicio);
+    struct timespec inicio;
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
     
-    //verificar si archivo cabe en memoria
-    size_t elementosEnMemoria = MEMORY_LIMIT / ELEMENT_SIZE;
+    //verificar si archivo cabe en memoria (descontando lo que usa el pool)
+    size_t elementosEnMemoria = elementosEnMemoriaConfig(cfg);
     
     if (numElementos <= elementosEnMemoria) {
         //caso base: archivo cabe en memoria, usar mergesort clasico
         printf("Archivo cabe en memoria, usando mergesort clasico\n");
         
-        if (ordenarSubarchivoEnMemoria(archivoEntrada, numElementos) != 0) {
-            return -1;
-        }
-        
-        //copiar archivo ordenado al archivo de salida
-        ArchivoBin entrada, salida;
-        if (abrirArchivo(&entrada, archivoEntrada, "rb") != 0 ||
-            abrirArchivo(&salida, archivoSalida, "wb") != 0) {
+        //se lee la entrada, se ordena y se escribe directo en la salida
+        if (ordenarArchivoEnMemoria(archivoEntrada, archivoSalida, numElementos, cfg) != 0) {
             return -1;
         }
-        
-        for (size_t i = 0; i < numElementos; i++) {
-            int64_t elemento;
-            if (leerElemento(&entrada, i, &elemento) != 0 ||
-                escribirElemento(&salida, i, elemento) != 0) {
-                cerrarArchivo(&entrada);
-                cerrarArchivo(&salida);
-                return -1;
-            }
-        }
-        
-        cerrarArchivo(&entrada);
-        cerrarArchivo(&salida);
     } else {
-        //caso recursivo: dividir, ordenar y mezclar
-        printf("Dividiendo archivo en %d subarchivos\n", aridad);
+        //fase 1: runs ordenados con seleccion por reemplazo (~2M elementos cada uno)
+        printf("Generando runs con seleccion por reemplazo\n");
+        char **nombresRuns = NULL;
+        size_t *tamañosRuns = NULL;
+        int numRuns = 0;
+        int resultado = generarRuns(archivoEntrada, numElementos, cfg, &nombresRuns, &tamañosRuns, &numRuns);
         
-        //crear nombres para subarchivos
-        char **nombresSubarchivos = malloc(aridad * sizeof(char*));
-        for (int i = 0; i < aridad; i++) {
-            nombresSubarchivos[i] = malloc(256);
-            snprintf(nombresSubarchivos[i], 256, "temp_sub_%d.bin", i);
+        //los runs tienen que cubrir toda la entrada (un archivo mas corto que
+        //numElementos dejaria una salida truncada)
+        size_t enRuns = 0;
+        for (int i = 0; i < numRuns && resultado == 0; i++) {
+            enRuns += tamañosRuns[i];
         }
-        
-        //dividir archivo
-        if (dividirArchivo(archivoEntrada, numElementos, aridad, nombresSubarchivos) != 0) {
-            //limpiar memoria
-            for (int i = 0; i < aridad; i++) {
-                free(nombresSubarchivos[i]);
-            }
-            free(nombresSubarchivos);
-            return -1;
+        if (resultado == 0 && enRuns != numElementos) {
+            printf("Error: los runs tienen %zu elementos y la entrada %zu\n", enRuns, numElementos);
+            resultado = -1;
         }
         
-        //ordenar cada subarchivo recursivamente
-        for (int i = 0; i < aridad; i++) {
-            size_t tamañoSubarchivo = obtenerTamañoArchivo(nombresSubarchivos[i]);
-            printf("Ordenando subarchivo %d (%zu elementos)\n", i, tamañoSubarchivo);
-            
-            //llamada recursiva
-            EstadisticasMerge statsTemp;
-            if (mergesortExterno(nombresSubarchivos[i], nombresSubarchivos[i], 
-                                tamañoSubarchivo, aridad, &statsTemp) != 0) {
-                //limpiar memoria
-                for (int j = 0; j < aridad; j++) {
-                    free(nombresSubarchivos[j]);
-                }
-                free(nombresSubarchivos);
-                return -1;
-            }
+        //fase 2: mezclar de a 'aridad' runs por pasada hasta dejar la salida
+        if (resultado == 0) {
+            printf("Mezclando %d runs con aridad %d\n", numRuns, aridad);
+            resultado = mezclarRuns(nombresRuns, tamañosRuns, &numRuns, aridad, archivoSalida, cfg);
         }
         
-        //mezclar subarchivos ordenados
-        printf("Mezclando %d subarchivos\n", aridad);
-        if (mezclarSubarchivos(nombresSubarchivos, aridad, archivoSalida, numElementos) != 0) {
-            //limpiar memoria
-            for (int i = 0; i < aridad; i++) {
-                free(nombresSubarchivos[i]);
-            }
-            free(nombresSubarchivos);
-            return -1;
+        //eliminar archivos temporales que queden
+        for (int i = 0; i < numRuns; i++) {
+            remove(nombresRuns[i]);
+            free(nombresRuns[i]);
         }
-        
-        //eliminar archivos temporales
-        for (int i = 0; i < aridad; i++) {
-            remove(nombresSubarchivos[i]);
-            free(nombresSubarchivos[i]);
+        free(nombresRuns);
+        free(tamañosRuns);
+        if (resultado != 0) {
+            return -1;
         }
-        free(nombresSubarchivos);
     }
     
     //guardar estadisticas
     if (stats) {
-        stats->accesosdisco = obtenerAccesos();
-        stats->tiempoEjecucion = ((double)(clock() - inicio)) / CLOCKS_PER_SEC;
+        EstadisticasIO ioFin;
+        copiarEstadisticas(cfg->estadisticas, &ioFin);
+        restarEstadisticas(&ioFin, &ioInicio, &stats->io);
+        stats->accesosdisco = accesosTotales(&stats->io);
+        stats->tiempoEjecucion = segundosRealesDesde(&inicio);
         stats->aridadUsada = aridad;
     }
     
     return 0;
 }
 
+//baja el elemento i del heap de minimos hasta su lugar
+void hundirEnHeap(int64_t *heap, size_t tamaño, size_t i) {
+    int64_t valor = heap[i];
+    while (1) {
+        size_t hijo = 2 * i + 1;
+        if (hijo >= tamaño) {
+            break;
+        }
+        if (hijo + 1 < tamaño && heap[hijo + 1] < heap[hijo]) {
+            hijo++;
+        }
+        if (heap[hijo] >= valor) {
+            break;
+        }
+        heap[i] = heap[hijo];
+        i = hijo;
+    }
+    heap[i] = valor;
+}
+
+//arma un heap de minimos con los primeros tamaño elementos
+void armarHeap(int64_t *heap, size_t tamaño) {
+    for (size_t i = tamaño / 2; i-- > 0;) {
+        hundirEnHeap(heap, tamaño, i);
+    }
+}
+
+//agrega un run nuevo, con nombre temporal unico, a la lista (crece de a poco con realloc)
+static int agregarRun(char ***nombresRuns, size_t **tamañosRuns, int *numRuns, int *capacidad) {
+    if (*numRuns == *capacidad) {
+        int nuevaCapacidad = (*capacidad > 0) ? 2 * *capacidad : 16;
+        char **nombres = realloc(*nombresRuns, nuevaCapacidad * sizeof(char*));
+        if (!nombres) {
+            return -1;
+        }
+        *nombresRuns = nombres;
+        size_t *tamaños = realloc(*tamañosRuns, nuevaCapacidad * sizeof(size_t));
+        if (!tamaños) {
+            return -1;
+        }
+        *tamañosRuns = tamaños;
+        *capacidad = nuevaCapacidad;
+    }
+    char *nombre = malloc(256);
+    if (!nombre) {
+        return -1;
+    }
+    nombreTemporal(nombre, 256, "run");
+    (*nombresRuns)[*numRuns] = nombre;
+    (*tamañosRuns)[*numRuns] = 0;
+    (*numRuns)++;
+    return 0;
+}
+
 /*
-divide un archivo grande en varios subarchivos
-archivoEntrada: archivo a dividir
-numElementos: total de elementos en el archivo
-aridad: numero de subarchivos a crear
-nombresSubarchivos: array con nombres de los subarchivos a crear
-return: 0 si exito, -1 si error
+genera runs ordenados con seleccion por reemplazo sobre [inicio, fin) de la entrada:
+un heap con lo que cabe en memoria entrega siempre el minimo del run actual, y cada
+elemento leido que es menor que el ultimo escrito queda guardado para el run siguiente
+en datos aleatorios los runs miden ~2 veces la memoria, y con la entrada ya
+ordenada se genera un solo run
+archivoEntrada: archivo a ordenar
+inicio: primer elemento del rango
+fin: posicion final (exclusiva) del rango
+cfg: tamaño de bloque, memoria y backend
+nombresRuns: aqui se deja el arreglo con los nombres de los runs creados
+tamañosRuns: aqui se deja el arreglo con el tamaño de cada run
+numRuns: aqui se deja la cantidad de runs
+return: 0 si exito, -1 si error (los runs creados quedan en los arreglos para limpiarlos)
 */
-int dividirArchivo(const char *archivoEntrada, size_t numElementos, 
-                   int aridad, char **nombresSubarchivos) {
-    
+static int generarRunsRango(const char *archivoEntrada, size_t inicio, size_t fin, const ConfigOrden *cfg,
+                            char ***nombresRuns, size_t **tamañosRuns, int *numRuns) {
+    OpcionesArchivo opciones = opcionesDeConfig(cfg);
+    size_t numElementos = fin - inicio;
+    *nombresRuns = NULL;
+    *tamañosRuns = NULL;
+    *numRuns = 0;
+    int capacidadRuns = 0;
+
+    //el heap usa la memoria de trabajo menos los buffers del lector y del escritor
+    size_t elementosEnMemoria = elementosEnMemoriaConfig(cfg);
+    int profundidad = LECTOR_PROFUNDIDAD;
+    size_t bloquesLector = bloquesAcotadosConfig(cfg, bloquesDeTrozo(cfg->tamBloque, LECTOR_BLOQUES),
+                                                 16 * LECTOR_PROFUNDIDAD);
+    size_t bloquesEscritor = bloquesAcotadosConfig(cfg, bloquesDeTrozo(cfg->tamBloque, ESCRITOR_BLOQUES), 16);
+    size_t buffers = (profundidad * bloquesLector + 2 * bloquesEscritor) * elementosPorBloqueConfig(cfg);
+    if (buffers > elementosEnMemoria / 2) {
+        //con M chica cada buffer ya tiene un solo bloque: se usan 2 buffers de
+        //lectura en vez de LECTOR_PROFUNDIDAD para que el heap conserve memoria
+        profundidad = 2;
+        bloquesLector = 1;
+        bloquesEscritor = 1;
+        buffers = 4 * elementosPorBloqueConfig(cfg);
+    }
+    if (buffers >= elementosEnMemoria) {
+        printf("Error: M = %zu no alcanza para el heap y los buffers de los runs\n", cfg->memoria);
+        return -1;
+    }
+    size_t capacidad = elementosEnMemoria - buffers;
+    if (capacidad > numElementos) {
+        capacidad = numElementos;
+    }
+
+    int64_t *heap = malloc(capacidad * sizeof(int64_t));
+    if (!heap) {
+        printf("Error: no se pudo allocar el heap de seleccion por reemplazo\n");
+        return -1;
+    }
+
     ArchivoBin entrada;
-    if (abrirArchivo(&entrada, archivoEntrada, "rb") != 0) {
+    LectorSecuencial lector;
+    if (abrirArchivoCon(&entrada, archivoEntrada, "rb", &opciones) != 0) {
+        free(heap);
         return -1;
     }
-    
-    //calcular tamaño de cada subarchivo
-    size_t elementosPorSubarchivo = numElementos / aridad;
-    size_t elementosExtra = numElementos % aridad;
-    
-    size_t posicionActual = 0;
-    
-    for (int i = 0; i < aridad; i++) {
-        //calcular tamaño de este subarchivo
-        size_t tamañoEsteSubarchivo = elementosPorSubarchivo;
-        if (i < elementosExtra) {
-            tamañoEsteSubarchivo++;
+    if (abrirLector(&lector, &entrada, inicio, fin, profundidad, bloquesLector) != 0) {
+        cerrarArchivo(&entrada);
+        free(heap);
+        return -1;
+    }
+
+    //llenar el heap con los primeros elementos
+    long leidos = leerSiguientes(&lector, capacidad, heap);
+    if (leidos < 0) {
+        cerrarLector(&lector);
+        cerrarArchivo(&entrada);
+        free(heap);
+        return -1;
+    }
+    size_t enHeap = (size_t)leidos;
+    size_t cargados = enHeap; //heap del run actual en [0, enHeap), guardados en [enHeap, cargados)
+    armarHeap(heap, enHeap);
+    int hayEntrada = (enHeap == capacidad);
+
+    int resultado = 0;
+    while (cargados > 0 && resultado == 0) {
+        //nuevo run con todo lo cargado
+        if (agregarRun(nombresRuns, tamañosRuns, numRuns, &capacidadRuns) != 0) {
+            resultado = -1;
+            break;
         }
-        
-        //crear subarchivo
-        ArchivoBin subarchivo;
-        if (abrirArchivo(&subarchivo, nombresSubarchivos[i], "wb") != 0) {
-            cerrarArchivo(&entrada);
-            return -1;
+        int run = *numRuns - 1;
+        ArchivoBin salida;
+        EscritorSecuencial escritor;
+        if (abrirArchivoCon(&salida, (*nombresRuns)[run], "wb", &opciones) != 0) {
+            resultado = -1;
+            break;
         }
-        
-        //copiar elementos al subarchivo
-        for (size_t j = 0; j < tamañoEsteSubarchivo; j++) {
-            int64_t elemento;
-            if (leerElemento(&entrada, posicionActual + j, &elemento) != 0 ||
-                escribirElemento(&subarchivo, j, elemento) != 0) {
-                cerrarArchivo(&entrada);
-                cerrarArchivo(&subarchivo);
-                return -1;
+        if (abrirEscritor(&escritor, &salida, 0, bloquesEscritor) != 0) {
+            cerrarArchivo(&salida);
+            resultado = -1;
+            break;
+        }
+
+        size_t escritos = 0;
+        while (enHeap > 0) {
+            int64_t minimo = heap[0];
+            if (agregarElemento(&escritor, minimo) != 0) {
+                resultado = -1;
+                break;
+            }
+            escritos++;
+            if (escritos % REVISION_LIMITE == 0 && limiteExcedido(cfg)) {
+                resultado = -1;
+                break;
+            }
+
+            //un error de lectura no es el final de la entrada
+            int64_t siguiente;
+            int leido = hayEntrada ? siguienteElemento(&lector, &siguiente) : 0;
+            if (leido < 0) {
+                resultado = -1;
+                break;
+            }
+            if (leido == 1) {
+                if (siguiente >= minimo) {
+                    //sigue en el run actual
+                    heap[0] = siguiente;
+                } else {
+                    //queda guardado para el run siguiente, el heap se achica
+                    heap[0] = heap[enHeap - 1];
+                    heap[enHeap - 1] = siguiente;
+                    enHeap--;
+                }
+            } else {
+                //sin entrada: el ultimo del heap pasa a la raiz y el ultimo
+                //guardado ocupa su lugar para que los guardados sigan contiguos
+                hayEntrada = 0;
+                heap[0] = heap[enHeap - 1];
+                heap[enHeap - 1] = heap[cargados - 1];
+                enHeap--;
+                cargados--;
+            }
+            if (enHeap > 0) {
+                hundirEnHeap(heap, enHeap, 0);
             }
         }
-        
-        cerrarArchivo(&subarchivo);
-        posicionActual += tamañoEsteSubarchivo;
-        
-        printf("Subarchivo %d: %zu elementos\n", i, tamañoEsteSubarchivo);
+
+        if (cerrarEscritor(&escritor) != 0) {
+            resultado = -1;
+        }
+        cerrarArchivo(&salida);
+        (*tamañosRuns)[run] = escritos;
+        printf("  Run %d: %zu elementos\n", run, escritos);
+
+        //los guardados forman el heap del run siguiente
+        enHeap = cargados;
+        armarHeap(heap, enHeap);
     }
-    
+
+    cerrarLector(&lector);
     cerrarArchivo(&entrada);
-    return 0;
+    free(heap);
+    return resultado;
+}
+
+//trabajo de un hilo al generar runs sobre su parte de la entrada
+typedef struct {
+    const char *archivoEntrada;
+    size_t inicio;
+    size_t fin;
+    ConfigOrden cfg; //con su parte de M y su propio contexto de I/O
+    EstadisticasIO io;
+    char **nombresRuns;
+    size_t *tamañosRuns;
+    int numRuns;
+    int resultado;
+} TareaRuns;
+
+static void *ejecutarTareaRuns(void *arg) {
+    TareaRuns *tarea = arg;
+    tarea->resultado = generarRunsRango(tarea->archivoEntrada, tarea->inicio, tarea->fin, &tarea->cfg,
+                                        &tarea->nombresRuns, &tarea->tamañosRuns, &tarea->numRuns);
+    return NULL;
+}
+
+//contexto donde se suman los accesos de los hilos de una operacion
+static EstadisticasIO *estadisticasDe(const ConfigOrden *cfg) {
+    return cfg->estadisticas ? cfg->estadisticas : estadisticasGlobales();
+}
+
+//copia de cfg para un hilo que trabaja con M / partes y cuenta en io
+static ConfigOrden configTrabajador(const ConfigOrden *cfg, int partes, EstadisticasIO *io) {
+    ConfigOrden copia = *cfg;
+    copia.memoria = cfg->memoria / partes;
+    copia.estadisticas = io;
+    copia.hilos = 1;
+    estadisticasACero(io);
+    return copia;
+}
+
+/*
+genera los runs de toda la entrada; con cfg->hilos > 1 la entrada se reparte en
+tramos que se procesan a la vez, cada uno con M / hilos de memoria (los runs salen
+del mismo largo relativo a su parte de M)
+archivoEntrada: archivo a ordenar
+numElementos: cantidad de elementos
+cfg: tamaño de bloque, memoria, backend e hilos
+nombresRuns: aqui se deja el arreglo con los nombres de los runs creados
+tamañosRuns: aqui se deja el arreglo con el tamaño de cada run
+numRuns: aqui se deja la cantidad de runs
+return: 0 si exito, -1 si error (los runs creados quedan en los arreglos para limpiarlos)
+*/
+int generarRuns(const char *archivoEntrada, size_t numElementos, const ConfigOrden *cfg,
+                char ***nombresRuns, size_t **tamañosRuns, int *numRuns) {
+    //cada hilo necesita un tramo que valga la pena y memoria para algo mas que sus buffers
+    size_t trabajadores = (size_t)cfg->hilos;
+    if (trabajadores > numElementos / MINIMO_POR_HILO) {
+        trabajadores = numElementos / MINIMO_POR_HILO;
+    }
+    if (trabajadores > cfg->memoria / (64 * cfg->tamBloque)) {
+        trabajadores = cfg->memoria / (64 * cfg->tamBloque);
+    }
+    if (trabajadores <= 1) {
+        return generarRunsRango(archivoEntrada, 0, numElementos, cfg, nombresRuns, tamañosRuns, numRuns);
+    }
+
+    *nombresRuns = NULL;
+    *tamañosRuns = NULL;
+    *numRuns = 0;
+    TareaRuns *tareas = calloc(trabajadores, sizeof(TareaRuns));
+    if (!tareas) {
+        return -1;
+    }
+    int w = (int)trabajadores;
+    for (int t = 0; t < w; t++) {
+        tareas[t].archivoEntrada = archivoEntrada;
+        tareas[t].inicio = numElementos * t / w;
+        tareas[t].fin = numElementos * (t + 1) / w;
+        tareas[t].cfg = configTrabajador(cfg, w, &tareas[t].io);
+    }
+    printf("  Generando runs con %d hilos\n", w);
+    ejecutarEnPool(ejecutarTareaRuns, tareas, sizeof(TareaRuns), w, w);
+
+    //juntar los runs y los accesos de todos los hilos
+    int total = 0;
+    int resultado = 0;
+    for (int t = 0; t < w; t++) {
+        total += tareas[t].numRuns;
+        sumarEstadisticas(estadisticasDe(cfg), &tareas[t].io);
+        if (tareas[t].resultado != 0) {
+            resultado = -1;
+        }
+    }
+    *nombresRuns = malloc((total > 0 ? total : 1) * sizeof(char*));
+    *tamañosRuns = malloc((total > 0 ? total : 1) * sizeof(size_t));
+    for (int t = 0; t < w; t++) {
+        for (int r = 0; r < tareas[t].numRuns; r++) {
+            if (*nombresRuns && *tamañosRuns) {
+                (*nombresRuns)[*numRuns] = tareas[t].nombresRuns[r];
+                (*tamañosRuns)[*numRuns] = tareas[t].tamañosRuns[r];
+                (*numRuns)++;
+            } else {
+                remove(tareas[t].nombresRuns[r]);
+                free(tareas[t].nombresRuns[r]);
+                resultado = -1;
+            }
+        }
+        free(tareas[t].nombresRuns);
+        free(tareas[t].tamañosRuns);
+    }
+    free(tareas);
+    return resultado;
+}
+
+//trabajo de un hilo al mezclar un grupo de runs de una pasada
+typedef struct {
+    char **nombres; //runs del grupo
+    int k;
+    size_t total;
+    char *salida;   //run nuevo, NULL si el grupo tiene un solo run
+    ConfigOrden cfg;
+    EstadisticasIO io;
+    int resultado;
+} TareaGrupo;
+
+static void *ejecutarTareaGrupo(void *arg) {
+    TareaGrupo *tarea = arg;
+    if (tarea->salida) {
+        tarea->resultado = mezclarSubarchivos(tarea->nombres, tarea->k, tarea->salida, tarea->total, &tarea->cfg);
+    }
+    return NULL;
+}
+
+/*
+grupos de una pasada que se pueden mezclar a la vez: cada mezcla tiene un buffer
+por entrada, la reserva del pronostico y dos buffers de escritura, cada uno de al
+menos LECTOR_BLOQUES bloques, y entre todas no pueden pasar de la memoria de trabajo
+*/
+static int gruposConcurrentes(const ConfigOrden *cfg, int aridad, int numGrupos) {
+    size_t porMezcla = ((size_t)aridad + PRONOSTICO_RESERVA + 2) *
+                       bloquesDeTrozo(cfg->tamBloque, LECTOR_BLOQUES) * cfg->tamBloque;
+    size_t grupos = (cfg->memoria - memoriaPoolConfig(cfg)) / porMezcla;
+    if (grupos > (size_t)cfg->hilos) {
+        grupos = cfg->hilos;
+    }
+    if (grupos > (size_t)numGrupos) {
+        grupos = numGrupos;
+    }
+    return (grupos > 0) ? (int)grupos : 1;
+}
+
+//ordena los runs de menor a mayor tamaño (son pocos, basta con insercion)
+static void ordenarRunsPorTamaño(char **nombresRuns, size_t *tamañosRuns, int numRuns) {
+    for (int i = 1; i < numRuns; i++) {
+        char *nombre = nombresRuns[i];
+        size_t tamaño = tamañosRuns[i];
+        int j = i;
+        while (j > 0 && tamañosRuns[j - 1] > tamaño) {
+            nombresRuns[j] = nombresRuns[j - 1];
+            tamañosRuns[j] = tamañosRuns[j - 1];
+            j--;
+        }
+        nombresRuns[j] = nombre;
+        tamañosRuns[j] = tamaño;
+    }
+}
+
+/*
+reparte los runs de una pasada en grupos consecutivos. con aridad fija son grupos de
+'aridad'; con aridad por nivel la pasada solo deja los runs que las pasadas
+siguientes pueden mezclar con toda la aridad (aridad^(pasadas - 1)), asi que mezcla
+los runs justos para eso en grupos parejos y el resto pasa sin copiarse (Knuth)
+numRuns: runs de la pasada (mas que aridad)
+aridad: maximo de runs por mezcla
+cfg: configuracion, de donde sale aridadPorNivel
+tamGrupos: aqui se deja el tamaño de cada grupo (hasta numRuns grupos)
+return: cantidad de grupos
+*/
+static int gruposDePasada(int numRuns, int aridad, const ConfigOrden *cfg, int *tamGrupos) {
+    int numGrupos = 0;
+    if (!cfg->aridadPorNivel) {
+        for (int i = 0; i < numRuns; i += aridad) {
+            tamGrupos[numGrupos++] = (numRuns - i < aridad) ? numRuns - i : aridad;
+        }
+        return numGrupos;
+    }
+
+    //runs que pueden quedar: aridad^(pasadas que faltan despues de esta)
+    long long objetivo = 1;
+    while (objetivo * aridad < numRuns) {
+        objetivo *= aridad;
+    }
+    int eliminar = numRuns - (int)objetivo;
+    int mezclas = (eliminar + aridad - 2) / (aridad - 1);
+    int mezclados = eliminar + mezclas;
+    for (int g = 0; g < mezclas; g++) {
+        tamGrupos[numGrupos++] = mezclados / mezclas + (g < mezclados % mezclas);
+    }
+    for (int i = mezclados; i < numRuns; i++) {
+        tamGrupos[numGrupos++] = 1;
+    }
+    return numGrupos;
+}
+
+/*
+mezcla runs ordenados de a lo mas 'aridad' por pasada; cada pasada deja runs nuevos
+hasta que quedan a lo mas 'aridad', y esos se mezclan directo en la salida. con
+cfg->aridadPorNivel la primera pasada mezcla solo los runs mas chicos que hacen falta
+para que las siguientes usen toda la aridad, con la misma cantidad de pasadas
+nombresRuns: nombres de los runs, se actualiza con los runs que quedan
+tamañosRuns: tamaño de cada run, se actualiza igual que los nombres
+numRuns: cantidad de runs, al terminar queda la cantidad de temporales sin borrar
+aridad: runs que se mezclan a la vez (el maximo con aridad por nivel)
+archivoSalida: archivo donde queda el resultado
+cfg: tamaño de bloque, memoria y backend
+return: 0 si exito, -1 si error
+*/
+int mezclarRuns(char **nombresRuns, size_t *tamañosRuns, int *numRuns, int aridad,
+                const char *archivoSalida, const ConfigOrden *cfg) {
+    if (aridad < 2) {
+        aridad = 2;
+    }
+    int pasada = 0;
+
+    while (*numRuns > aridad) {
+        pasada++;
+
+        //los grupos de una pasada son independientes: se reparten entre hilos
+        int *tamGrupos = malloc(*numRuns * sizeof(int));
+        if (!tamGrupos) {
+            return -1;
+        }
+        if (cfg->aridadPorNivel) {
+            ordenarRunsPorTamaño(nombresRuns, tamañosRuns, *numRuns);
+        }
+        int numGrupos = gruposDePasada(*numRuns, aridad, cfg, tamGrupos);
+        int mayor = 1, mezclas = 0;
+        for (int g = 0; g < numGrupos; g++) {
+            mayor = (tamGrupos[g] > mayor) ? tamGrupos[g] : mayor;
+            mezclas += (tamGrupos[g] > 1);
+        }
+        int concurrentes = gruposConcurrentes(cfg, mayor, mezclas);
+        TareaGrupo *grupos = calloc(numGrupos, sizeof(TareaGrupo));
+        if (!grupos) {
+            free(tamGrupos);
+            return -1;
+        }
+        for (int g = 0, i = 0; g < numGrupos; i += tamGrupos[g], g++) {
+            grupos[g].nombres = &nombresRuns[i];
+            grupos[g].k = tamGrupos[g];
+            for (int j = i; j < i + grupos[g].k; j++) {
+                grupos[g].total += tamañosRuns[j];
+            }
+            grupos[g].cfg = configTrabajador(cfg, concurrentes, &grupos[g].io);
+            //un run solo pasa tal cual a la siguiente pasada
+            if (grupos[g].k > 1) {
+                grupos[g].salida = malloc(256);
+                if (grupos[g].salida) {
+                    nombreTemporal(grupos[g].salida, 256, "run");
+                } else {
+                    grupos[g].resultado = -1;
+                    grupos[g].k = -grupos[g].k; //no se mezcla
+                }
+            }
+        }
+        ejecutarEnPool(ejecutarTareaGrupo, grupos, sizeof(TareaGrupo), numGrupos, concurrentes);
+
+        //runs de la pasada siguiente, quedan en [0, nuevos); si un grupo fallo sus
+        //runs se conservan en la lista para poder borrarlos
+        int nuevos = 0;
+        int error = 0;
+        for (int g = 0, i = 0; g < numGrupos; i += tamGrupos[g], g++) {
+            int k = (grupos[g].k < 0) ? -grupos[g].k : grupos[g].k;
+            sumarEstadisticas(estadisticasDe(cfg), &grupos[g].io);
+            if (grupos[g].salida && grupos[g].resultado == 0) {
+                //los runs mezclados ya no se necesitan
+                for (int j = i; j < i + k; j++) {
+                    remove(nombresRuns[j]);
+                    free(nombresRuns[j]);
+                }
+                nombresRuns[nuevos] = grupos[g].salida;
+                tamañosRuns[nuevos] = grupos[g].total;
+                nuevos++;
+                continue;
+            }
+            if (grupos[g].resultado != 0) {
+                error = 1;
+                if (grupos[g].salida) {
+                    remove(grupos[g].salida);
+                    free(grupos[g].salida);
+                }
+            }
+            for (int j = i; j < i + k; j++) {
+                nombresRuns[nuevos] = nombresRuns[j];
+                tamañosRuns[nuevos] = tamañosRuns[j];
+                nuevos++;
+            }
+        }
+        free(grupos);
+        free(tamGrupos);
+        *numRuns = nuevos;
+        if (error) {
+            return -1;
+        }
+        printf("  Pasada %d: %d mezclas de hasta %d runs, quedan %d runs (%d mezclas a la vez)\n", pasada, mezclas,
+               mayor, *numRuns, concurrentes);
+    }
+
+    //un solo run ya es la salida
+    if (*numRuns == 1 && rename(nombresRuns[0], archivoSalida) == 0) {
+        free(nombresRuns[0]);
+        *numRuns = 0;
+        return 0;
+    }
+
+    size_t total = 0;
+    for (int i = 0; i < *numRuns; i++) {
+        total += tamañosRuns[i];
+    }
+    return mezclarSubarchivos(nombresRuns, *numRuns, archivoSalida, total, cfg);
 }
 
 /*
 ordena un subarchivo que cabe en memoria usando mergesort clasico
 nombreArchivo: archivo a ordenar en lugar
 numElementos: cantidad de elementos en el archivo
+cfg: tamaño de bloque, memoria y backend
 return: 0 si exito, -1 si error
 */
-int ordenarSubarchivoEnMemoria(const char *nombreArchivo, size_t numElementos) {
-    //cargar archivo completo en memoria
+int ordenarSubarchivoEnMemoria(const char *nombreArchivo, size_t numElementos, const ConfigOrden *cfg) {
+    OpcionesArchivo opciones = opcionesDeConfig(cfg);
+    ArchivoBin archivo;
+    if (abrirArchivoCon(&archivo, nombreArchivo, "r+b", &opciones) != 0) {
+        return -1;
+    }
+    int resultado = ordenarVistaEnMemoria(&archivo, &archivo, numElementos, cfg);
+    cerrarArchivo(&archivo);
+    return resultado;
+}
+
+/*
+carga un archivo que cabe en memoria, lo ordena con mergesort clasico (o radix
+sort si cfg->motor lo pide, con cfg->hilos hilos) y escribe el resultado en otro archivo (puede ser el mismo)
+archivoEntrada: archivo a ordenar
+archivoSalida: archivo donde guardar el resultado
+numElementos: cantidad de elementos en el archivo
+cfg: tamaño de bloque, memoria, backend, motor e hilos en memoria
+return: 0 si exito, -1 si error
+*/
+int ordenarArchivoEnMemoria(const char *archivoEntrada, const char *archivoSalida, size_t numElementos,
+                            const ConfigOrden *cfg) {
+    if (strcmp(archivoEntrada, archivoSalida) == 0) {
+        return ordenarSubarchivoEnMemoria(archivoEntrada, numElementos, cfg);
+    }
+    OpcionesArchivo opciones = opcionesDeConfig(cfg);
+    ArchivoBin entrada, salida;
+    if (abrirArchivoCon(&entrada, archivoEntrada, "rb", &opciones) != 0) {
+        return -1;
+    }
+    if (abrirArchivoCon(&salida, archivoSalida, "wb", &opciones) != 0) {
+        cerrarArchivo(&entrada);
+        return -1;
+    }
+    int resultado = ordenarVistaEnMemoria(&entrada, &salida, numElementos, cfg);
+    cerrarArchivo(&salida);
+    cerrarArchivo(&entrada);
+    return resultado;
+}
+
+/*
+ordena en memoria los primeros numElementos de un archivo o vista abierta y los
+escribe desde la posicion 0 de otro (o del mismo, para ordenar en lugar); con vistas
+un tramo de un archivo se ordena sin copiarlo a un archivo propio
+entrada: archivo o vista de donde leer
+salida: archivo o vista donde escribir (puede ser entrada)
+numElementos: elementos a ordenar, deben caber en memoria
+cfg: tamaño de bloque, memoria, backend, motor e hilos en memoria
+return: 0 si exito, -1 si error
+*/
+int ordenarVistaEnMemoria(ArchivoBin *entrada, ArchivoBin *salida, size_t numElementos, const ConfigOrden *cfg) {
+    //cargar el tramo completo en memoria
     int64_t *arreglo = malloc(numElementos * sizeof(int64_t));
     if (!arreglo) {
         printf("Error\n");
         return -1;
     }
-    
-    //leer archivo a memoria
-    ArchivoBin archivo;
-    if (abrirArchivo(&archivo, nombreArchivo, "rb") != 0) {
+    if (leerRango(entrada, 0, numElementos, arreglo) != 0) {
         free(arreglo);
         return -1;
     }
     
-    for (size_t i = 0; i < numElementos; i++) {
-        if (leerElemento(&archivo, i, &arreglo[i]) != 0) {
-            free(arreglo);
-            cerrarArchivo(&archivo);
-            return -1;
+    //ordenar en memoria: el auxiliar usa lo que queda de M despues del arreglo
+    //(hasta numElementos); si no queda nada la mezcla es en el lugar
+    size_t tamAux = auxiliarEnMemoriaConfig(cfg, numElementos);
+    int64_t *aux = NULL;
+    if (tamAux > 0) {
+        aux = malloc(tamAux * sizeof(int64_t));
+        if (!aux) {
+            tamAux = 0;
         }
     }
-    cerrarArchivo(&archivo);
-    
-    //ordenar en memoria
     printf("  Ordenando %zu elementos en memoria\n", numElementos);
-    mergesortClasico(arreglo, numElementos);
+    ordenarEnMemoriaCon(cfg, arreglo, numElementos, aux, tamAux, mergesortClasicoCon);
+    free(aux);
     
-    //escribir de vuelta al archivo
-    if (abrirArchivo(&archivo, nombreArchivo, "wb") != 0) {
-        free(arreglo);
-        return -1;
-    }
-    
-    for (size_t i = 0; i < numElementos; i++) {
-        if (escribirElemento(&archivo, i, arreglo[i]) != 0) {
-            free(arreglo);
-            cerrarArchivo(&archivo);
-            return -1;
-        }
-    }
-    
-    cerrarArchivo(&archivo);
+    //escribir el resultado
+    int resultado = escribirRango(salida, 0, numElementos, arreglo);
     free(arreglo);
-    return 0;
+    return resultado;
+}
+
+/*
+reparte la memoria de trabajo de una mezcla en buffers iguales: uno por cada una de
+las k entradas, los PRONOSTICO_RESERVA de la lectura con pronostico y los dos del
+escritor, asi cada flujo se lee o escribe en pocos accesos grandes en vez de bloque
+a bloque (los accesos se siguen contando por bloque)
+cfg: tamaño de bloque y memoria de la mezcla
+k: cantidad de entradas
+bloquesLector: aqui se dejan los bloques por buffer de las entradas
+bloquesEscritor: aqui se dejan los bloques por buffer del escritor
+*/
+static void buffersDeMezcla(const ConfigOrden *cfg, int k, size_t *bloquesLector, size_t *bloquesEscritor) {
+    size_t bloques = bloquesEnMemoriaConfig(cfg) / ((size_t)k + PRONOSTICO_RESERVA + 2);
+    if (bloques < 1) bloques = 1;
+    *bloquesLector = bloques;
+    *bloquesEscritor = bloques;
 }
 
 /*
-mezcla multiples subarchivos ordenados en uno solo
+mezcla con arbol de perdedores el tramo [desde[i], hasta[i]) de cada subarchivo y
+escribe el resultado en [inicioSalida, inicioSalida + numElementos) de la salida
 nombresSubarchivos: array con nombres de subarchivos ordenados
 numArchivos: cantidad de subarchivos
+desde: primer elemento de cada subarchivo, NULL para leerlos completos
+hasta: posicion final (exclusiva) en cada subarchivo, NULL para leerlos completos
 archivoSalida: archivo donde guardar el resultado mezclado
-numElementosTotal: total de elementos esperados
+modoSalida: "wb" para crear la salida, "r+b" para escribir en una ya reservada
+inicioSalida: posicion de la salida donde va el primer elemento mezclado
+numElementos: elementos a mezclar
+cfg: tamaño de bloque, memoria y backend
 return: 0 si exito, -1 si error
 */
-int mezclarSubarchivos(char **nombresSubarchivos, int numArchivos, 
-                       const char *archivoSalida, size_t numElementosTotal) {
+static int mezclarTramos(char **nombresSubarchivos, int numArchivos, const size_t *desde, const size_t *hasta,
+                         const char *archivoSalida, const char *modoSalida, size_t inicioSalida,
+                         size_t numElementos, const ConfigOrden *cfg) {
     
-    //abrir todos los subarchivos para lectura
+    OpcionesArchivo opciones = opcionesDeConfig(cfg);
+    size_t bloquesLector, bloquesEscritor;
+    buffersDeMezcla(cfg, numArchivos, &bloquesLector, &bloquesEscritor);
+
+    //abrir todos los subarchivos para lectura, con lectura anticipada por pronostico
     ArchivoBin *subarchivos = malloc(numArchivos * sizeof(ArchivoBin));
-    size_t *posiciones = malloc(numArchivos * sizeof(size_t));
-    size_t *tamaños = malloc(numArchivos * sizeof(size_t));
-    int64_t *valoresActuales = malloc(numArchivos * sizeof(int64_t));
-    int *activos = malloc(numArchivos * sizeof(int));
+    LectorPronostico lector;
+    NodoTorneo *hojas = malloc(numArchivos * sizeof(NodoTorneo));
+    ArbolPerdedores arbol;
+    arbol.k = numArchivos;
     
-    for (int i = 0; i < numArchivos; i++) {
-        if (abrirArchivo(&subarchivos[i], nombresSubarchivos[i], "rb") != 0) {
-            //limpiar en caso de error
-            for (int j = 0; j < i; j++) {
-                cerrarArchivo(&subarchivos[j]);
-            }
-            free(subarchivos);
-            free(posiciones);
-            free(tamaños);
-            free(valoresActuales);
-            free(activos);
-            return -1;
+    int abiertos = 0;
+    while (subarchivos && abiertos < numArchivos &&
+           abrirArchivoCon(&subarchivos[abiertos], nombresSubarchivos[abiertos], "rb", &opciones) == 0) {
+        abiertos++;
+    }
+    if (abiertos < numArchivos || !hojas ||
+        abrirLectorPronostico(&lector, subarchivos, desde, hasta, numArchivos, bloquesLector) != 0) {
+        //limpiar en caso de error
+        for (int j = 0; j < abiertos; j++) {
+            cerrarArchivo(&subarchivos[j]);
         }
-        
-        posiciones[i] = 0;
-        tamaños[i] = obtenerTamañoArchivo(nombresSubarchivos[i]);
-        activos[i] = (tamaños[i] > 0) ? 1 : 0;
-        
-        //leer primer elemento de cada subarchivo
-        if (activos[i]) {
-            if (leerElemento(&subarchivos[i], 0, &valoresActuales[i]) != 0) {
-                activos[i] = 0;
-            }
+        free(subarchivos);
+        free(hojas);
+        return -1;
+    }
+    
+    //leer primer elemento de cada subarchivo
+    for (int i = 0; i < numArchivos; i++) {
+        hojas[i].fuente = i;
+        if (siguientePronostico(&lector, i, &hojas[i].clave) != 1) {
+            hojas[i] = nodoAgotado(&arbol, i);
         }
     }
     
-    //abrir archivo de salida
+    //abrir archivo de salida, se escribe en orden con escritura agrupada
     ArchivoBin salida;
-    if (abrirArchivo(&salida, archivoSalida, "wb") != 0) {
+    EscritorSecuencial escritor;
+    if (crearArbolPerdedores(&arbol, hojas, numArchivos) != 0 ||
+        abrirArchivoCon(&salida, archivoSalida, modoSalida, &opciones) != 0 ||
+        abrirEscritor(&escritor, &salida, inicioSalida, bloquesEscritor) != 0) {
+        cerrarLectorPronostico(&lector);
         for (int i = 0; i < numArchivos; i++) {
             cerrarArchivo(&subarchivos[i]);
         }
+        free(arbol.nodos);
         free(subarchivos);
-        free(posiciones);
-        free(tamaños);
-        free(valoresActuales);
-        free(activos);
+        free(hojas);
         return -1;
     }
     
-    //merge de k-vias (k-way merge)
+    //merge de k-vias (k-way merge) con arbol de perdedores
     size_t elementosEscritos = 0;
+    int error = 0;
     
-    while (elementosEscritos < numElementosTotal) {
-        //encontrar el minimo de todos los valores actuales
-        int indiceMenor = -1;
-        int64_t valorMenor;
-        
-        for (int i = 0; i < numArchivos; i++) {
-            if (activos[i]) {
-                if (indiceMenor == -1 || valoresActuales[i] < valorMenor) {
-                    indiceMenor = i;
-                    valorMenor = valoresActuales[i];
-                }
-            }
-        }
-        
-        if (indiceMenor == -1) {
+    while (elementosEscritos < numElementos) {
+        //el minimo de todas las entradas esta en la raiz
+        NodoTorneo ganador = arbol.nodos[0];
+        if (ganador.fuente >= numArchivos) {
             printf("Error: no hay mas elementos para mezclar\n");
+            error = 1;
             break;
         }
         
         //escribir el menor al archivo de salida
-        if (escribirElemento(&salida, elementosEscritos, valorMenor) != 0) {
-            printf("Error escribiendo elemento %zu\n", elementosEscritos);
+        if (agregarElemento(&escritor, ganador.clave) != 0) {
+            printf("Error escribiendo elemento %zu\n", inicioSalida + elementosEscritos);
+            error = 1;
             break;
         }
         
         elementosEscritos++;
-        posiciones[indiceMenor]++;
+        if (elementosEscritos % REVISION_LIMITE == 0 && limiteExcedido(cfg)) {
+            error = 1;
+            break;
+        }
         
-        //leer siguiente elemento del subarchivo elegido
-        if (posiciones[indiceMenor] < tamaños[indiceMenor]) {
-            if (leerElemento(&subarchivos[indiceMenor], posiciones[indiceMenor], 
-                            &valoresActuales[indiceMenor]) != 0) {
-                activos[indiceMenor] = 0;
-            }
-        } else {
-            activos[indiceMenor] = 0;
+        //el siguiente elemento del subarchivo elegido sube por su camino del arbol
+        NodoTorneo siguiente;
+        siguiente.fuente = ganador.fuente;
+        if (siguientePronostico(&lector, ganador.fuente, &siguiente.clave) != 1) {
+            siguiente = nodoAgotado(&arbol, ganador.fuente);
         }
+        reemplazarGanador(&arbol, siguiente);
     }
     
     //cerrar todos los archivos
+    int resultado = cerrarEscritor(&escritor);
+    if (error) {
+        resultado = -1;
+    }
     cerrarArchivo(&salida);
+    cerrarLectorPronostico(&lector);
     for (int i = 0; i < numArchivos; i++) {
         cerrarArchivo(&subarchivos[i]);
     }
     
     //liberar memoria
+    free(arbol.nodos);
     free(subarchivos);
-    free(posiciones);
-    free(tamaños);
-    free(valoresActuales);
-    free(activos);
+    free(hojas);
     
-    printf("  Elementos mezclados: %zu\n", elementosEscritos);
+    return resultado;
+}
+
+//cuenta los elementos de un archivo ordenado menores que clave (o <= si inclusivo)
+//con busqueda binaria; devuelve -1 si falla una lectura
+static int contarMenores(ArchivoBin *archivo, size_t n, int64_t clave, int inclusivo, size_t *cuenta) {
+    size_t bajo = 0;
+    size_t alto = n;
+    while (bajo < alto) {
+        size_t mitad = bajo + (alto - bajo) / 2;
+        int64_t valor;
+        if (leerElemento(archivo, mitad, &valor) != 0) {
+            return -1;
+        }
+        if (valor < clave || (inclusivo && valor == clave)) {
+            bajo = mitad + 1;
+        } else {
+            alto = mitad;
+        }
+    }
+    *cuenta = bajo;
     return 0;
 }
 
 /*
-encuentra la aridad optima usando busqueda binaria
+ubica un corte de la mezcla de k subarchivos ordenados: los primeros 'rango'
+elementos de la salida son [0, cortes[i]) de cada subarchivo i. se busca la menor
+clave v con al menos 'rango' elementos <= v; los menores a v quedan antes del corte
+y los iguales se reparten en orden de subarchivo, igual que los desempata el arbol
+de perdedores, asi mezclar cada parte por separado da la misma salida
+subarchivos: subarchivos abiertos para lectura
+tamaños: elementos de cada subarchivo
+k: cantidad de subarchivos
+rango: elementos de la salida antes del corte
+cortes: aqui se deja la posicion del corte en cada subarchivo
+return: 0 si exito, -1 si error
+*/
+static int cortarSubarchivos(ArchivoBin *subarchivos, const size_t *tamaños, int k, size_t rango, size_t *cortes) {
+    //la clave buscada esta entre el menor primero y el mayor ultimo
+    int64_t bajo = INT64_MAX;
+    int64_t alto = INT64_MIN;
+    for (int i = 0; i < k; i++) {
+        int64_t primero, ultimo;
+        if (tamaños[i] == 0) {
+            continue;
+        }
+        if (leerElemento(&subarchivos[i], 0, &primero) != 0 ||
+            leerElemento(&subarchivos[i], tamaños[i] - 1, &ultimo) != 0) {
+            return -1;
+        }
+        if (primero < bajo) bajo = primero;
+        if (ultimo > alto) alto = ultimo;
+    }
+
+    while (bajo < alto) {
+        int64_t mitad = (int64_t)((uint64_t)bajo + (((uint64_t)alto - (uint64_t)bajo) >> 1));
+        size_t hastaMitad = 0;
+        for (int i = 0; i < k; i++) {
+            size_t cuenta;
+            if (contarMenores(&subarchivos[i], tamaños[i], mitad, 1, &cuenta) != 0) {
+                return -1;
+            }
+            hastaMitad += cuenta;
+        }
+        if (hastaMitad >= rango) {
+            alto = mitad;
+        } else {
+            bajo = mitad + 1;
+        }
+    }
+
+    size_t antes = 0;
+    for (int i = 0; i < k; i++) {
+        if (contarMenores(&subarchivos[i], tamaños[i], bajo, 0, &cortes[i]) != 0) {
+            return -1;
+        }
+        antes += cortes[i];
+    }
+    size_t resto = rango - antes;
+    for (int i = 0; i < k && resto > 0; i++) {
+        size_t hastaIgual;
+        if (contarMenores(&subarchivos[i], tamaños[i], bajo, 1, &hastaIgual) != 0) {
+            return -1;
+        }
+        size_t iguales = hastaIgual - cortes[i];
+        size_t tomados = (iguales < resto) ? iguales : resto;
+        cortes[i] += tomados;
+        resto -= tomados;
+    }
+    return 0;
+}
+
+//trabajo de un hilo en una mezcla de k vias repartida: su parte de la salida
+typedef struct {
+    char **nombres;
+    int k;
+    const size_t *desde;
+    const size_t *hasta;
+    const char *archivoSalida;
+    size_t inicioSalida;
+    size_t numElementos;
+    ConfigOrden cfg;
+    EstadisticasIO io;
+    int resultado;
+} TareaTramo;
+
+static void *ejecutarTareaTramo(void *arg) {
+    TareaTramo *tarea = arg;
+    tarea->resultado = mezclarTramos(tarea->nombres, tarea->k, tarea->desde, tarea->hasta, tarea->archivoSalida,
+                                     "r+b", tarea->inicioSalida, tarea->numElementos, &tarea->cfg);
+    return NULL;
+}
+
+/*
+mezcla los subarchivos repartiendo la salida en 'partes' tramos que se mezclan a
+la vez: los cortes se ubican con cortarSubarchivos en posiciones multiplo de un
+bloque (asi dos hilos nunca escriben el mismo bloque) y cada hilo lee su tramo de
+cada subarchivo y escribe en su parte de la salida, ya reservada con su tamaño final
+return: 0 si exito, -1 si error
+*/
+static int mezclarSubarchivosParalelo(char **nombresSubarchivos, int numArchivos, const char *archivoSalida,
+                                      size_t numElementosTotal, int partes, const ConfigOrden *cfg) {
+    OpcionesArchivo opciones = opcionesDeConfig(cfg);
+    size_t elementosBloque = elementosPorBloqueConfig(cfg);
+    ArchivoBin *subarchivos = malloc(numArchivos * sizeof(ArchivoBin));
+    size_t *cortes = malloc((size_t)(partes + 1) * numArchivos * sizeof(size_t));
+    TareaTramo *tareas = calloc(partes, sizeof(TareaTramo));
+    if (!subarchivos || !cortes || !tareas) {
+        free(subarchivos);
+        free(cortes);
+        free(tareas);
+        return -1;
+    }
+
+    //fila p de cortes: donde empieza la parte p en cada subarchivo
+    int abiertos = 0;
+    int resultado = 0;
+    for (; abiertos < numArchivos; abiertos++) {
+        if (abrirArchivoCon(&subarchivos[abiertos], nombresSubarchivos[abiertos], "rb", &opciones) != 0) {
+            resultado = -1;
+            break;
+        }
+        cortes[abiertos] = 0;
+        cortes[(size_t)partes * numArchivos + abiertos] = elementosArchivo(&subarchivos[abiertos]);
+    }
+    for (int p = 1; p < partes && resultado == 0; p++) {
+        size_t rango = numElementosTotal * p / partes / elementosBloque * elementosBloque;
+        resultado = cortarSubarchivos(subarchivos, cortes + (size_t)partes * numArchivos, numArchivos,
+                                      rango, cortes + (size_t)p * numArchivos);
+    }
+    for (int i = 0; i < abiertos; i++) {
+        cerrarArchivo(&subarchivos[i]);
+    }
+    free(subarchivos);
+    if (resultado == 0 && reservarArchivo(archivoSalida, numElementosTotal) != 0) {
+        resultado = -1;
+    }
+    if (resultado != 0) {
+        free(cortes);
+        free(tareas);
+        return -1;
+    }
+
+    size_t inicio = 0;
+    for (int p = 0; p < partes; p++) {
+        tareas[p].nombres = nombresSubarchivos;
+        tareas[p].k = numArchivos;
+        tareas[p].desde = cortes + (size_t)p * numArchivos;
+        tareas[p].hasta = cortes + (size_t)(p + 1) * numArchivos;
+        tareas[p].archivoSalida = archivoSalida;
+        tareas[p].inicioSalida = inicio;
+        for (int i = 0; i < numArchivos; i++) {
+            tareas[p].numElementos += tareas[p].hasta[i] - tareas[p].desde[i];
+        }
+        inicio += tareas[p].numElementos;
+        tareas[p].cfg = configTrabajador(cfg, partes, &tareas[p].io);
+    }
+    ejecutarEnPool(ejecutarTareaTramo, tareas, sizeof(TareaTramo), partes, partes);
+
+    for (int p = 0; p < partes; p++) {
+        sumarEstadisticas(estadisticasDe(cfg), &tareas[p].io);
+        if (tareas[p].resultado != 0) {
+            resultado = -1;
+        }
+    }
+    if (inicio != numElementosTotal) {
+        printf("Error: los subarchivos tienen %zu elementos y se esperaban %zu\n", inicio, numElementosTotal);
+        resultado = -1;
+    }
+    free(cortes);
+    free(tareas);
+    return resultado;
+}
+
+/*
+mezcla multiples subarchivos ordenados en uno solo; con cfg->hilos > 1 la salida
+se reparte entre hilos (el resultado es el mismo que mezclando en un solo hilo)
+nombresSubarchivos: array con nombres de subarchivos ordenados
+numArchivos: cantidad de subarchivos
+archivoSalida: archivo donde guardar el resultado mezclado
+numElementosTotal: total de elementos esperados
+cfg: tamaño de bloque, memoria y backend
+return: 0 si exito, -1 si error
+*/
+int mezclarSubarchivos(char **nombresSubarchivos, int numArchivos, 
+                       const char *archivoSalida, size_t numElementosTotal,
+                       const ConfigOrden *cfg) {
+    //cada parte tiene que valer la pena y su mezcla caber en su parte de M
+    int partes = gruposConcurrentes(cfg, numArchivos, cfg->hilos);
+    if ((size_t)partes > numElementosTotal / MINIMO_POR_HILO) {
+        partes = (int)(numElementosTotal / MINIMO_POR_HILO);
+    }
+
+    int resultado;
+    if (partes > 1) {
+        resultado = mezclarSubarchivosParalelo(nombresSubarchivos, numArchivos, archivoSalida,
+                                               numElementosTotal, partes, cfg);
+    } else {
+        resultado = mezclarTramos(nombresSubarchivos, numArchivos, NULL, NULL, archivoSalida, "wb",
+                                  0, numElementosTotal, cfg);
+    }
+    if (resultado == 0) {
+        printf("  Elementos mezclados: %zu\n", numElementosTotal);
+    }
+    return resultado;
+}
+
+/*
+encuentra la aridad optima con B y M por defecto
 archivoPrueba: archivo para probar diferentes valores  
 numElementos: cantidad de elementos en el archivo
 return: aridad optima encontrada, -1 si error
 */
 int encontrarAridadOptima(const char *archivoPrueba, size_t numElementos) {
-    int b = ELEMENTS_PER_BLOCK; 
+    ConfigOrden cfg = configPorDefecto();
+    return encontrarAridadOptimaCon(archivoPrueba, numElementos, &cfg);
+}
+
+/*
+encuentra la aridad optima usando busqueda binaria
+archivoPrueba: archivo para probar diferentes valores  
+numElementos: cantidad de elementos en el archivo
+cfg: tamaño de bloque, memoria y backend con que se prueba
+return: aridad optima encontrada, -1 si error
+*/
+int encontrarAridadOptimaCon(const char *archivoPrueba, size_t numElementos, const ConfigOrden *cfg) {
+    int b = calcularMaxAridad(cfg); 
     int aridadMin = 2;
     int aridadMax = b;
     
@@ -374,30 +1227,10 @@ int encontrarAridadOptima(const char *archivoPrueba, size_t numElementos) {
         int aridadActual = aridadesAProbar[i];
         if (aridadActual < aridadMin || aridadActual > aridadMax) continue;
         
-        //hacer copia del archivo original para prueba
-        char archivoCopia[256];
-        snprintf(archivoCopia, sizeof(archivoCopia), "copia_prueba_%d.bin", aridadActual);
-        
-        //copiar archivo original
-        ArchivoBin original, copia;
-        if (abrirArchivo(&original, archivoPrueba, "rb") != 0 ||
-            abrirArchivo(&copia, archivoCopia, "wb") != 0) {
-            continue;
-        }
-        
-        for (size_t j = 0; j < numElementos; j++) {
-            int64_t elemento;
-            if (leerElemento(&original, j, &elemento) != 0 ||
-                escribirElemento(&copia, j, elemento) != 0) {
-                break;
-            }
-        }
-        cerrarArchivo(&original);
-        cerrarArchivo(&copia);
-        
-        //probar esta aridad
+        //probar esta aridad; mergesort no modifica su entrada, asi que no hace falta
+        //copiar el archivo original para cada prueba
         EstadisticasMerge stats;
-        if (probarAridad(archivoCopia, numElementos, aridadActual, &stats) == 0) {
+        if (probarAridad(archivoPrueba, numElementos, aridadActual, cfg, &stats) == 0) {
             printf("Aridad %d: %.3f seg, %lld accesos\n", 
                    aridadActual, stats.tiempoEjecucion, stats.accesosdisco);
             
@@ -409,9 +1242,6 @@ int encontrarAridadOptima(const char *archivoPrueba, size_t numElementos) {
                 mejorAridad = aridadActual;
             }
         }
-        
-        //limpiar archivo temporal
-        remove(archivoCopia);
     }
     
     printf("=== Aridad optima encontrada: %d ===\n", mejorAridad);
@@ -419,22 +1249,169 @@ int encontrarAridadOptima(const char *archivoPrueba, size_t numElementos) {
     return mejorAridad;
 }
 
+//resultado de una prueba de la busqueda adaptativa
+typedef struct {
+    int probada;
+    int abortada;   //paso el tiempo de la mejor, solo se sabe que es peor
+    double tiempo;
+    long long accesos;
+} PruebaAridad;
+
+//1 si la prueba a es mejor que b: menos tiempo, y con empate menos accesos
+static int pruebaMejor(const PruebaAridad *a, const PruebaAridad *b) {
+    if (a->abortada || !a->probada) {
+        return 0;
+    }
+    if (b->abortada || !b->probada) {
+        return 1;
+    }
+    return a->tiempo < b->tiempo || (a->tiempo == b->tiempo && a->accesos < b->accesos);
+}
+
+/*
+corre (una sola vez) la prueba de una aridad, abandonandola si su tiempo real pasa el
+de la mejor hasta ahora (con reloj real: clock() no ve la espera al disco y suma los hilos)
+return: 0 si exito (probada o abortada), -1 si error
+*/
+static int probarAridadAcotada(const char *archivoPrueba, size_t numElementos, int aridad,
+                               const ConfigOrden *cfg, PruebaAridad *pruebas, int *mejor) {
+    PruebaAridad *prueba = &pruebas[aridad];
+    if (prueba->probada) {
+        return 0;
+    }
+    ConfigOrden acotada = *cfg;
+    double inicio = relojReal();
+    if (*mejor > 0) {
+        acotada.limiteReloj = inicio + pruebas[*mejor].tiempo;
+    }
+    EstadisticasMerge stats;
+    prueba->probada = 1;
+    if (probarAridad(archivoPrueba, numElementos, aridad, &acotada, &stats) != 0) {
+        if (!limiteExcedido(&acotada)) {
+            return -1;
+        }
+        prueba->abortada = 1;
+        printf("Aridad %d: abortada, mas lenta que la aridad %d\n", aridad, *mejor);
+        return 0;
+    }
+    prueba->tiempo = relojReal() - inicio;
+    prueba->accesos = stats.accesosdisco;
+    printf("Aridad %d: %.3f seg, %lld accesos\n", aridad, prueba->tiempo, prueba->accesos);
+    if (*mejor < 0 || pruebaMejor(prueba, &pruebas[*mejor])) {
+        *mejor = aridad;
+    }
+    return 0;
+}
+
+//aridad en la posicion x de la escala logaritmica [log2 minimo, log2 maximo]
+static int aridadEnEscala(double x, int minimo, int maximo) {
+    int aridad = (int)lround(exp2(x));
+    return (aridad < minimo) ? minimo : (aridad > maximo) ? maximo : aridad;
+}
+
+/*
+busca la aridad optima con pocas pruebas: ordena los primeros N / BUSQUEDA_ESCALA
+elementos con M / BUSQUEDA_ESCALA (asi la cantidad de runs y de pasadas es la misma
+que con la entrada completa, y no hace falta copiar el archivo porque mergesort no
+lo modifica), refina con busqueda por seccion aurea sobre log2(aridad) (las pasadas
+dependen de log_aridad(runs)) y abandona cada prueba en cuanto su tiempo pasa el de
+la mejor. los accesos solo desempatan: abortar por accesos descartaria aridades
+chicas que hacen mas accesos pero terminan antes
+archivoPrueba: archivo para probar diferentes valores
+numElementos: cantidad de elementos en el archivo
+cfg: tamaño de bloque, memoria y backend con que se va a ordenar
+return: aridad optima encontrada, -1 si error
+*/
+int buscarAridadAdaptativaCon(const char *archivoPrueba, size_t numElementos, const ConfigOrden *cfg) {
+    if (prepararConfig(cfg) != 0) {
+        return -1;
+    }
+    ConfigOrden escalada = *cfg;
+    size_t escala = BUSQUEDA_ESCALA;
+    while (escala > 1 && cfg->memoria / escala < BUSQUEDA_MEMORIA_MINIMA) {
+        escala /= 2;
+    }
+    escalada.memoria = cfg->memoria / escala;
+    size_t n = numElementos / escala;
+
+    //la aridad escalada no puede pasar la que permite M / escala
+    int aridadMin = 2;
+    int aridadMax = calcularMaxAridad(cfg);
+    if (calcularMaxAridad(&escalada) < aridadMax) {
+        aridadMax = calcularMaxAridad(&escalada);
+    }
+    printf("=== Buscando aridad optima con seccion aurea (N = %zu, M = %zu) ===\n", n, escalada.memoria);
+    printf("Rango: [%d, %d]\n", aridadMin, aridadMax);
+
+    PruebaAridad *pruebas = calloc(aridadMax + 1, sizeof(PruebaAridad));
+    if (!pruebas) {
+        return -1;
+    }
+    double inicio = relojReal();
+    int mejor = -1;
+    int resultado = 0;
+
+    //seccion aurea: el intervalo se achica a 1/phi por prueba, y con aridades enteras
+    //se termina cuando quedan pocas y se prueban todas
+    const double invPhi = (sqrt(5.0) - 1) / 2;
+    double a = log2(aridadMin);
+    double b = log2(aridadMax);
+    double c = b - invPhi * (b - a);
+    double d = a + invPhi * (b - a);
+    while (resultado == 0 && aridadEnEscala(b, aridadMin, aridadMax) - aridadEnEscala(a, aridadMin, aridadMax) > 3) {
+        int aridadC = aridadEnEscala(c, aridadMin, aridadMax);
+        int aridadD = aridadEnEscala(d, aridadMin, aridadMax);
+        if (probarAridadAcotada(archivoPrueba, n, aridadC, &escalada, pruebas, &mejor) != 0 ||
+            probarAridadAcotada(archivoPrueba, n, aridadD, &escalada, pruebas, &mejor) != 0) {
+            resultado = -1;
+            break;
+        }
+        //con aridades iguales (intervalo chico) igual se avanza hacia la mejor
+        if (pruebaMejor(&pruebas[aridadD], &pruebas[aridadC])) {
+            a = c;
+            c = d;
+            d = a + invPhi * (b - a);
+        } else {
+            b = d;
+            d = c;
+            c = b - invPhi * (b - a);
+        }
+    }
+    for (int aridad = aridadEnEscala(a, aridadMin, aridadMax);
+         resultado == 0 && aridad <= aridadEnEscala(b, aridadMin, aridadMax); aridad++) {
+        resultado = probarAridadAcotada(archivoPrueba, n, aridad, &escalada, pruebas, &mejor);
+    }
+
+    int probadas = 0, abortadas = 0;
+    for (int aridad = aridadMin; aridad <= aridadMax; aridad++) {
+        probadas += pruebas[aridad].probada;
+        abortadas += pruebas[aridad].abortada;
+    }
+    if (resultado == 0 && mejor > 0) {
+        printf("=== Aridad optima encontrada: %d (%d pruebas, %d abortadas, %.3f seg) ===\n", mejor, probadas,
+               abortadas, relojReal() - inicio);
+    }
+    free(pruebas);
+    return (resultado == 0) ? mejor : -1;
+}
+
 /*
 prueba un valor de aridad especifico
 archivoPrueba: archivo para ordenar
 numElementos: cantidad de elementos
 aridad: valor de aridad a probar
+cfg: tamaño de bloque, memoria y backend
 stats: estructura para guardar estadisticas
 return: 0 si exito, -1 si error
 */
 int probarAridad(const char *archivoPrueba, size_t numElementos, 
-                 int aridad, EstadisticasMerge *stats) {
+                 int aridad, const ConfigOrden *cfg, EstadisticasMerge *stats) {
     
     char archivoSalida[256];
     snprintf(archivoSalida, sizeof(archivoSalida), "salida_prueba_%d.bin", aridad);
     
     //ejecutar mergesort con esta aridad
-    int resultado = mergesortExterno(archivoPrueba, archivoSalida, numElementos, aridad, stats);
+    int resultado = mergesortExternoCon(archivoPrueba, archivoSalida, numElementos, aridad, cfg, stats);
     
     //limpiar archivo de salida
     remove(archivoSalida);
@@ -443,37 +1420,211 @@ int probarAridad(const char *archivoPrueba, size_t numElementos,
 }
 
 /*
-calcula la maxima aridad posible basada en el tamaño de bloque
+calcula la maxima aridad posible basada en el tamaño de bloque y la memoria
+cfg: tamaño de bloque, memoria y backend
 return: maxima aridad calculada
 */
-int calcularMaxAridad(void) {
+int calcularMaxAridad(const ConfigOrden *cfg) {
     //la aridad maxima esta limitada por cuántos elementos caben en un bloque
-    return ELEMENTS_PER_BLOCK;
+    size_t aridad = elementosPorBloqueConfig(cfg);
+
+    //y por la memoria: cada entrada del merge necesita al menos un bloque, ademas de
+    //la reserva del pronostico y los dos buffers del escritor (importa con B grandes)
+    size_t bloques = bloquesEnMemoriaConfig(cfg);
+    size_t porMemoria = (bloques > PRONOSTICO_RESERVA + 2) ? bloques - PRONOSTICO_RESERVA - 2 : 0;
+    if (porMemoria < aridad) {
+        aridad = porMemoria;
+    }
+    if (aridad < 2) {
+        aridad = 2;
+    }
+    return (int)aridad;
+}
+/*
+mergesort de abajo hacia arriba alternando entre arreglo y aux: cada pasada mezcla
+de un arreglo al otro, asi que no se copia de vuelta en cada nivel. si la cantidad
+de pasadas es impar los tramos iniciales se arman en aux, para que la ultima
+pasada termine en arreglo. los tramos iniciales de TRAMO_SIMD elementos y las
+mezclas usan los kernels de simd.c
+arreglo: arreglo a ordenar
+aux: arreglo auxiliar de al menos n elementos
+n: cantidad de elementos
+*/
+static void mergesortAbajoArriba(int64_t *arreglo, int64_t *aux, size_t n) {
+    int pasadas = 0;
+    for (size_t ancho = TRAMO_SIMD; ancho < n; ancho *= 2) {
+        pasadas++;
+    }
+
+    int64_t *origen = arreglo;
+    int64_t *destino = aux;
+    if (pasadas % 2 == 1) {
+        memcpy(aux, arreglo, n * sizeof(int64_t));
+        origen = aux;
+        destino = arreglo;
+    }
+
+    ordenarTramos(origen, n);
+
+    for (size_t ancho = TRAMO_SIMD; ancho < n; ancho *= 2) {
+        for (size_t inicio = 0; inicio < n; inicio += 2 * ancho) {
+            size_t medio = (n - inicio < ancho) ? n : inicio + ancho;
+            size_t fin = (n - inicio < 2 * ancho) ? n : inicio + 2 * ancho;
+            mezclarOrdenados(origen + inicio, medio - inicio, origen + medio, fin - medio,
+                             destino + inicio);
+        }
+        int64_t *temp = origen;
+        origen = destino;
+        destino = temp;
+    }
+}
+
+//invierte el orden de un tramo
+static void invertirTramo(int64_t *arreglo, size_t n) {
+    for (size_t i = 0, j = n; i + 1 < j; i++, j--) {
+        int64_t temp = arreglo[i];
+        arreglo[i] = arreglo[j - 1];
+        arreglo[j - 1] = temp;
+    }
+}
+
+//intercambia arreglo[0, n1) con arreglo[n1, n1 + n2) sin memoria extra
+static void rotarTramos(int64_t *arreglo, size_t n1, size_t n2) {
+    invertirTramo(arreglo, n1);
+    invertirTramo(arreglo + n1, n2);
+    invertirTramo(arreglo, n1 + n2);
+}
+
+//primera posicion de arreglo[0, n) con valor >= clave
+static size_t primeraNoMenor(const int64_t *arreglo, size_t n, int64_t clave) {
+    size_t bajo = 0, alto = n;
+    while (bajo < alto) {
+        size_t mitad = bajo + (alto - bajo) / 2;
+        if (arreglo[mitad] < clave) {
+            bajo = mitad + 1;
+        } else {
+            alto = mitad;
+        }
+    }
+    return bajo;
+}
+
+//primera posicion de arreglo[0, n) con valor > clave
+static size_t primeraMayor(const int64_t *arreglo, size_t n, int64_t clave) {
+    size_t bajo = 0, alto = n;
+    while (bajo < alto) {
+        size_t mitad = bajo + (alto - bajo) / 2;
+        if (arreglo[mitad] <= clave) {
+            bajo = mitad + 1;
+        } else {
+            alto = mitad;
+        }
+    }
+    return bajo;
+}
+
+/*
+mezcla estable de arreglo[0, medio) con arreglo[medio, n) usando a lo mas tamAux
+elementos extra: si el tramo mas corto cabe en aux se copia ahi y se mezcla de vuelta;
+si no, se parte el problema con una busqueda binaria y una rotacion hasta que quepa
+(con tamAux 0 la mezcla es completamente en el lugar)
+arreglo: arreglo con ambos tramos ordenados
+medio: inicio del segundo tramo
+n: cantidad total de elementos
+aux: arreglo auxiliar, puede ser NULL si tamAux es 0
+tamAux: elementos disponibles en aux
+*/
+void mezclarConBuffer(int64_t *arreglo, size_t medio, size_t n, int64_t *aux, size_t tamAux) {
+    while (medio > 0 && medio < n && arreglo[medio - 1] > arreglo[medio]) {
+        size_t n1 = medio;
+        size_t n2 = n - medio;
+
+        if (n1 <= n2 && n1 <= tamAux) {
+            //el tramo izquierdo va a aux y se mezcla hacia adelante
+            memcpy(aux, arreglo, n1 * sizeof(int64_t));
+            mezclarOrdenados(aux, n1, arreglo + medio, n2, arreglo);
+            return;
+        }
+        if (n2 <= tamAux) {
+            //el tramo derecho va a aux y se mezcla hacia atras
+            memcpy(aux, arreglo + medio, n2 * sizeof(int64_t));
+            size_t i = n1, j = n2, k = n;
+            while (i > 0 && j > 0) {
+                arreglo[--k] = (aux[j - 1] < arreglo[i - 1]) ? arreglo[--i] : aux[--j];
+            }
+            memcpy(arreglo, aux, j * sizeof(int64_t));
+            return;
+        }
+
+        //partir el tramo mas largo por la mitad, ubicar su corte en el otro tramo y
+        //rotar para dejar dos mezclas independientes mas chicas
+        size_t corte1, corte2;
+        if (n1 >= n2) {
+            corte1 = n1 / 2;
+            corte2 = medio + primeraNoMenor(arreglo + medio, n2, arreglo[corte1]);
+        } else {
+            corte2 = medio + n2 / 2;
+            corte1 = primeraMayor(arreglo, n1, arreglo[corte2]);
+        }
+        rotarTramos(arreglo + corte1, medio - corte1, corte2 - medio);
+        size_t nuevoMedio = corte1 + (corte2 - medio);
+
+        //la mezcla de la izquierda es recursiva y la de la derecha sigue en el ciclo
+        mezclarConBuffer(arreglo, corte1, nuevoMedio, aux, tamAux);
+        arreglo += nuevoMedio;
+        medio = corte2 - nuevoMedio;
+        n -= nuevoMedio;
+    }
 }
 
 /*
-implementa mergesort clasico en memoria
+implementa mergesort clasico en memoria con un solo arreglo auxiliar por orden
 arreglo: arreglo a ordenar
 n: cantidad de elementos
 return: 0 si exito, -1 si error
 */
 int mergesortClasico(int64_t *arreglo, size_t n) {
-    if (n <= 1) return 0;
-    
+    //con la mitad de n como auxiliar cada mitad se ordena alternando entre arreglos
+    //y la mezcla final solo copia una mitad; si no hay memoria, todo es en el lugar
+    size_t tamAux = (n + 1) / 2;
+    int64_t *aux = malloc(tamAux * sizeof(int64_t));
+    if (!aux) {
+        tamAux = 0;
+    }
+    int resultado = mergesortClasicoCon(arreglo, n, aux, tamAux);
+    free(aux);
+    return resultado;
+}
+
+/*
+mergesort en memoria sin reservar memoria: con tamAux >= n es de abajo hacia arriba
+alternando entre arreglo y aux; con menos se ordenan las mitades por separado y se
+mezclan con lo que quepa en aux
+arreglo: arreglo a ordenar
+n: cantidad de elementos
+aux: arreglo auxiliar, puede ser NULL si tamAux es 0
+tamAux: elementos disponibles en aux
+return: 0 si exito, -1 si error
+*/
+int mergesortClasicoCon(int64_t *arreglo, size_t n, int64_t *aux, size_t tamAux) {
+    if (n <= TRAMO_SIMD) {
+        ordenarTramoCorto(arreglo, n);
+        return 0;
+    }
+    if (tamAux >= n) {
+        mergesortAbajoArriba(arreglo, aux, n);
+        return 0;
+    }
+
     size_t medio = n / 2;
-    
-    //ordenar recursivamente cada mitad
-    mergesortClasico(arreglo, medio);
-    mergesortClasico(arreglo + medio, n - medio);
-    
-    //mezclar las dos mitades ordenadas
-    mergeClasico(arreglo, 0, medio, n);
-    
+    mergesortClasicoCon(arreglo, medio, aux, tamAux);
+    mergesortClasicoCon(arreglo + medio, n - medio, aux, tamAux);
+    mezclarConBuffer(arreglo, medio, n, aux, tamAux);
     return 0;
 }
 
 /*
-mezcla dos subarreglos ordenados en uno solo
+mezcla dos subarreglos ordenados en uno solo, en el lugar (sin memoria extra)
 arreglo: arreglo que contiene ambos subarreglos
 inicio: indice inicial del primer subarreglo
 medio: indice donde empieza el segundo subarreglo
@@ -481,48 +1632,5 @@ fin: indice final (exclusivo) del segundo subarreglo
 return: void
 */
 void mergeClasico(int64_t *arreglo, size_t inicio, size_t medio, size_t fin) {
-    //crear arreglos temporales para las dos mitades
-    size_t n1 = medio - inicio;
-    size_t n2 = fin - medio;
-    
-    int64_t *izquierda = malloc(n1 * sizeof(int64_t));
-    int64_t *derecha = malloc(n2 * sizeof(int64_t));
-    
-    //copiar datos a arreglos temporales
-    for (size_t i = 0; i < n1; i++) {
-        izquierda[i] = arreglo[inicio + i];
-    }
-    for (size_t j = 0; j < n2; j++) {
-        derecha[j] = arreglo[medio + j];
-    }
-    
-    //mezclar los arreglos temporales de vuelta al arreglo original
-    size_t i = 0, j = 0, k = inicio;
-    
-    while (i < n1 && j < n2) {
-        if (izquierda[i] <= derecha[j]) {
-            arreglo[k] = izquierda[i];
-            i++;
-        } else {
-            arreglo[k] = derecha[j];
-            j++;
-        }
-        k++;
-    }
-    
-    //copiar elementos restantes
-    while (i < n1) {
-        arreglo[k] = izquierda[i];
-        i++;
-        k++;
-    }
-    
-    while (j < n2) {
-        arreglo[k] = derecha[j];
-        j++;
-        k++;
-    }
-    
-    free(izquierda);
-    free(derecha);
-}
\ No newline at end of file
+    mezclarConBuffer(arreglo + inicio, medio - inicio, fin - inicio, NULL, 0);
+}
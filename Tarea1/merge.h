@@ -2,12 +2,17 @@
 #define MERGE_H
 
 #include "disco.h"
+#include "config.h"
 #include <stdint.h>
 
+#define BUSQUEDA_ESCALA 8  //la busqueda adaptativa prueba con N / ESCALA y M / ESCALA
+#define BUSQUEDA_MEMORIA_MINIMA (2 * 1024 * 1024)  //M minimo de las pruebas escaladas
+
 //estructura para estadisticas de mergesort externo
 typedef struct {
     long long accesosdisco;
-    double tiempoEjecucion;
+    EstadisticasIO io; //detalle de los accesos (lecturas, escrituras, bytes, saltos, descargas)
+    double tiempoEjecucion; //segundos de reloj real (con varios hilos no se suma la CPU de cada uno)
     int aridadUsada;
 } EstadisticasMerge;
 
@@ -15,24 +20,47 @@ typedef struct {
 int mergesortExterno(const char *archivoEntrada, const char *archivoSalida, 
                      size_t numElementos, int aridad, EstadisticasMerge *stats);
 
+int mergesortExternoCon(const char *archivoEntrada, const char *archivoSalida, 
+                        size_t numElementos, int aridad, const ConfigOrden *cfg,
+                        EstadisticasMerge *stats);
+
 //auxiliares
-int dividirArchivo(const char *archivoEntrada, size_t numElementos, 
-                   int aridad, char **nombresSubarchivos);
+int generarRuns(const char *archivoEntrada, size_t numElementos, const ConfigOrden *cfg,
+                char ***nombresRuns, size_t **tamañosRuns, int *numRuns);
+
+int mezclarRuns(char **nombresRuns, size_t *tamañosRuns, int *numRuns, int aridad,
+                const char *archivoSalida, const ConfigOrden *cfg);
+
+int ordenarSubarchivoEnMemoria(const char *nombreArchivo, size_t numElementos, const ConfigOrden *cfg);
 
-int ordenarSubarchivoEnMemoria(const char *nombreArchivo, size_t numElementos);
+//heap de minimos de la seleccion por reemplazo
+void hundirEnHeap(int64_t *heap, size_t tamaño, size_t i);
+void armarHeap(int64_t *heap, size_t tamaño);
+
+int ordenarArchivoEnMemoria(const char *archivoEntrada, const char *archivoSalida, size_t numElementos,
+                            const ConfigOrden *cfg);
+
+int ordenarVistaEnMemoria(ArchivoBin *entrada, ArchivoBin *salida, size_t numElementos, const ConfigOrden *cfg);
 
 int mezclarSubarchivos(char **nombresSubarchivos, int numArchivos, 
-                       const char *archivoSalida, size_t numElementosTotal);
+                       const char *archivoSalida, size_t numElementosTotal,
+                       const ConfigOrden *cfg);
 
 //funciones aridad optima
 int encontrarAridadOptima(const char *archivoPrueba, size_t numElementos);
 
+int encontrarAridadOptimaCon(const char *archivoPrueba, size_t numElementos, const ConfigOrden *cfg);
+
+int buscarAridadAdaptativaCon(const char *archivoPrueba, size_t numElementos, const ConfigOrden *cfg);
+
 int probarAridad(const char *archivoPrueba, size_t numElementos, 
-                 int aridad, EstadisticasMerge *stats);
+                 int aridad, const ConfigOrden *cfg, EstadisticasMerge *stats);
 
 //funciones de utilidad
-int calcularMaxAridad(void);
+int calcularMaxAridad(const ConfigOrden *cfg);
 int mergesortClasico(int64_t *arreglo, size_t n);
+int mergesortClasicoCon(int64_t *arreglo, size_t n, int64_t *aux, size_t tamAux);
 void mergeClasico(int64_t *arreglo, size_t inicio, size_t medio, size_t fin);
+void mezclarConBuffer(int64_t *arreglo, size_t medio, size_t n, int64_t *aux, size_t tamAux);
 
 #endif 
\ No newline at end of file
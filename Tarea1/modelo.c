@@ -0,0 +1,405 @@
+#include "modelo.h"
+#include "merge.h"
+#include "quick.h"
+#include "paralelo.h"
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+/*
+lee el archivo de calibracion completo con buffers de bloquesPorBuffer bloques; se
+mide con reloj real y no con clock(), que solo cuenta CPU y no ve el tiempo que el
+hilo de I/O pasa bloqueado en el disco ni la espera del que consume
+return: segundos que tomo, negativo si error
+*/
+static double medirLectura(ArchivoBin *archivo, size_t bloquesPorBuffer, int64_t *destino) {
+    LectorSecuencial lector;
+    struct timespec inicio;
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    if (abrirLector(&lector, archivo, 0, elementosArchivo(archivo), 1, bloquesPorBuffer) != 0) {
+        return -1;
+    }
+    long leidos;
+    while ((leidos = leerSiguientes(&lector, archivo->elementosBloque, destino)) > 0) {
+    }
+    cerrarLector(&lector);
+    if (leidos < 0) {
+        return -1;
+    }
+    return segundosRealesDesde(&inicio);
+}
+
+/*
+mide los costos del modelo: escribe y lee un archivo de CALIBRACION_BLOQUES bloques
+con el backend de cfg, una vez de a un bloque por lectura y otra de a
+CALIBRACION_TROZO (cada vez con el archivo fuera de la cache de paginas), lo que separa el costo fijo de cada solicitud del de cada bloque;
+ordena CALIBRACION_ELEMENTOS claves al azar para el costo de una comparacion, y hace
+otros tantos reemplazos en un heap de CALIBRACION_HEAP claves para el de un nivel del
+heap (mucho mayor, porque los niveles de abajo no caben en cache). todo se mide con
+reloj real, el mismo de tiempoEjecucion, para que la prediccion se pueda comparar con
+lo medido. los accesos de la medicion no se suman a ninguna estadistica
+cfg: configuracion con que se va a ordenar
+calibracion: aqui se dejan los costos medidos
+return: 0 si exito, -1 si error
+*/
+int calibrarCosto(const ConfigOrden *cfg, CalibracionCosto *calibracion) {
+    if (prepararConfig(cfg) != 0) {
+        return -1;
+    }
+    EstadisticasIO io;
+    estadisticasACero(&io);
+    ConfigOrden copia = *cfg;
+    copia.estadisticas = &io;
+    OpcionesArchivo opciones = opcionesDeConfig(&copia);
+    size_t elementosBloque = elementosPorBloqueConfig(cfg);
+    size_t bloques = CALIBRACION_BLOQUES;
+    size_t n = bloques * elementosBloque;
+
+    int64_t *datos = malloc(((n > CALIBRACION_ELEMENTOS) ? n : CALIBRACION_ELEMENTOS) * sizeof(int64_t));
+    if (!datos) {
+        return -1;
+    }
+    for (size_t i = 0; i < n || i < CALIBRACION_ELEMENTOS; i++) {
+        datos[i] = ((int64_t)rand() << 32) ^ rand();
+    }
+
+    char nombre[256];
+    nombreTemporal(nombre, sizeof(nombre), "calibracion");
+    ArchivoBin archivo;
+    EscritorSecuencial escritor;
+    int resultado = -1;
+    if (abrirArchivoCon(&archivo, nombre, "wb", &opciones) == 0) {
+        if (abrirEscritor(&escritor, &archivo, 0, bloquesDeTrozo(cfg->tamBloque, ESCRITOR_BLOQUES)) == 0) {
+            resultado = agregarRango(&escritor, datos, n);
+            if (cerrarEscritor(&escritor) != 0) {
+                resultado = -1;
+            }
+        }
+        cerrarArchivo(&archivo);
+    }
+
+    //cada lectura parte con el archivo fuera de la cache de paginas: si no, con stdio y
+    //mmap se mediria una copia en memoria y no el dispositivo
+    double porBloque = -1, porTrozo = -1;
+    size_t trozos[2] = {1, CALIBRACION_TROZO};
+    double *medidas[2] = {&porBloque, &porTrozo};
+    for (int i = 0; i < 2 && resultado == 0; i++) {
+        if (descartarCache(nombre) != 0 || abrirArchivoCon(&archivo, nombre, "rb", &opciones) != 0) {
+            resultado = -1;
+            break;
+        }
+        *medidas[i] = medirLectura(&archivo, trozos[i], datos);
+        cerrarArchivo(&archivo);
+    }
+    remove(nombre);
+    if (porBloque < 0 || porTrozo < 0) {
+        free(datos);
+        return -1;
+    }
+
+    //porBloque = bloques * (solicitud + bloque); porTrozo = bloques / TROZO * solicitud + bloques * bloque
+    double solicitudesTrozo = (double)bloques / CALIBRACION_TROZO;
+    double porSolicitud = (porBloque - porTrozo) / ((double)bloques - solicitudesTrozo);
+    if (porSolicitud < 0) {
+        porSolicitud = 0;
+    }
+    double transferencia = (porTrozo - solicitudesTrozo * porSolicitud) / (double)bloques;
+    if (transferencia < 0) {
+        transferencia = 0;
+    }
+    calibracion->segundosPorSolicitud = porSolicitud;
+    calibracion->segundosPorBloque = transferencia;
+
+    //comparaciones: un ordenamiento en memoria como el de los casos base
+    for (size_t i = 0; i < CALIBRACION_ELEMENTOS; i++) {
+        datos[i] = ((int64_t)rand() << 32) ^ rand();
+    }
+    struct timespec inicio;
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    mergesortClasico(datos, CALIBRACION_ELEMENTOS);
+    double ordenar = segundosRealesDesde(&inicio);
+    calibracion->segundosPorComparacion = ordenar / (CALIBRACION_ELEMENTOS * log2(CALIBRACION_ELEMENTOS));
+    free(datos);
+
+    //seleccion por reemplazo: sacar el minimo y hundir la clave que entra
+    int64_t *heap = malloc(CALIBRACION_HEAP * sizeof(int64_t));
+    if (!heap) {
+        return -1;
+    }
+    for (size_t i = 0; i < CALIBRACION_HEAP; i++) {
+        heap[i] = ((int64_t)rand() << 32) ^ rand();
+    }
+    armarHeap(heap, CALIBRACION_HEAP);
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    for (size_t i = 0; i < CALIBRACION_ELEMENTOS; i++) {
+        heap[0] = ((int64_t)rand() << 32) ^ rand();
+        hundirEnHeap(heap, CALIBRACION_HEAP, 0);
+    }
+    double reemplazar = segundosRealesDesde(&inicio);
+    calibracion->segundosPorNivelHeap = reemplazar / (CALIBRACION_ELEMENTOS * log2(CALIBRACION_HEAP));
+    free(heap);
+    return 0;
+}
+
+//bloques que ocupan n elementos
+static double bloquesDe(const ConfigOrden *cfg, double n) {
+    return ceil(n / (double)elementosPorBloqueConfig(cfg));
+}
+
+//buffer de E/S acotado a una fraccion de la memoria de trabajo, como en los algoritmos
+static double bloquesAcotados(const ConfigOrden *cfg, size_t bloques, size_t fraccion) {
+    return (double)bloquesAcotadosConfig(cfg, bloques, fraccion);
+}
+
+//n log2 n, el costo de ordenar n elementos en memoria
+static double ordenarEnMemoria(double n) {
+    return (n > 1) ? n * log2(n) : 0;
+}
+
+//pasa de accesos, solicitudes y comparaciones a segundos
+static void completarPrediccion(const CalibracionCosto *calibracion, PrediccionCosto *prediccion) {
+    prediccion->segundos = prediccion->accesos * calibracion->segundosPorBloque +
+                           prediccion->solicitudes * calibracion->segundosPorSolicitud +
+                           prediccion->comparaciones * calibracion->segundosPorComparacion +
+                           prediccion->nivelesHeap * calibracion->segundosPorNivelHeap;
+}
+
+/*
+predice el costo de mergesortExternoCon sobre una entrada al azar: runs de ~2 veces
+la memoria de cada hilo con seleccion por reemplazo, y ceil(log_aridad(runs))
+pasadas de mezcla que leen y escriben todo (salvo la primera con aridad por nivel);
+en cada mezcla la memoria se reparte en aridad + PRONOSTICO_RESERVA + 2 buffers, asi
+que una aridad mayor hace mas solicitudes
+cfg: configuracion del ordenamiento
+numElementos: N
+aridad: aridad de las mezclas
+calibracion: costos medidos
+prediccion: aqui se deja el costo predicho
+*/
+void predecirMergesort(const ConfigOrden *cfg, size_t numElementos, int aridad,
+                       const CalibracionCosto *calibracion, PrediccionCosto *prediccion) {
+    double n = (double)numElementos;
+    double bloques = bloquesDe(cfg, n);
+    size_t enMemoria = elementosEnMemoriaConfig(cfg);
+    prediccion->niveles = 0;
+    prediccion->nivelesHeap = 0;
+
+    if (numElementos <= enMemoria) {
+        prediccion->accesos = 2 * bloques;
+        prediccion->solicitudes = 2 * ceil(bloques / bloquesDeTrozo(cfg->tamBloque, COPIA_BLOQUES));
+        prediccion->comparaciones = ordenarEnMemoria(n);
+        completarPrediccion(calibracion, prediccion);
+        return;
+    }
+
+    //generacion de runs, repartida entre hilos como en generarRuns
+    size_t hilos = (size_t)cfg->hilos;
+    if (hilos > numElementos / MINIMO_POR_HILO) hilos = numElementos / MINIMO_POR_HILO;
+    if (hilos > cfg->memoria / (64 * cfg->tamBloque)) hilos = cfg->memoria / (64 * cfg->tamBloque);
+    if (hilos < 1) hilos = 1;
+    ConfigOrden porHilo = *cfg;
+    porHilo.memoria = cfg->memoria / hilos;
+    double heap = (double)elementosEnMemoriaConfig(&porHilo);
+    double runs = ceil(n / (2 * heap));
+    double bloquesLector = bloquesAcotados(&porHilo, bloquesDeTrozo(cfg->tamBloque, LECTOR_BLOQUES), 16 * LECTOR_PROFUNDIDAD);
+    double bloquesEscritor = bloquesAcotados(&porHilo, bloquesDeTrozo(cfg->tamBloque, ESCRITOR_BLOQUES), 16);
+    prediccion->accesos = 2 * bloques + runs;
+    prediccion->solicitudes = bloques / bloquesLector + bloques / bloquesEscritor + runs;
+    prediccion->comparaciones = 0;
+    prediccion->nivelesHeap = n * log2(heap);
+
+    //pasadas de mezcla hasta dejar la salida
+    double quedan = runs;
+    while (quedan > 1) {
+        quedan = ceil(quedan / aridad);
+        prediccion->niveles++;
+    }
+    double entradas = (runs < aridad) ? runs : aridad;
+    for (int pasada = 1; pasada <= prediccion->niveles; pasada++) {
+        //con aridad por nivel la primera de varias pasadas mezcla solo los runs justos
+        //(como gruposDePasada), y en grupos parejos de 'grupo' runs
+        double fraccion = 1;
+        double grupo = entradas;
+        if (cfg->aridadPorNivel && pasada == 1 && prediccion->niveles > 1) {
+            double eliminar = runs - pow(aridad, prediccion->niveles - 1);
+            double mezclas = ceil(eliminar / (aridad - 1));
+            fraccion = (eliminar + mezclas) / runs;
+            grupo = ceil((eliminar + mezclas) / mezclas);
+        }
+        double buffer = floor((double)bloquesEnMemoriaConfig(cfg) / (grupo + PRONOSTICO_RESERVA + 2));
+        if (buffer < 1) {
+            buffer = 1;
+        }
+        prediccion->accesos += 2 * fraccion * bloques;
+        prediccion->solicitudes += 2 * fraccion * bloques / buffer;
+        prediccion->comparaciones += fraccion * n * log2((grupo > 1) ? grupo : 2);
+    }
+    completarPrediccion(calibracion, prediccion);
+}
+
+//parametros de quicksortExternoCon que usa la simulacion
+typedef struct {
+    const ConfigOrden *cfg;
+    int aridad;               //pedida, cada nivel usa aridadDeNivel
+    double enMemoria;
+    double bloquesLector;
+    double bloquesCopia;
+    double bloquesSalida;     //buffer del escritor al concatenar
+} ParametrosQuick;
+
+//buffer de cada particion al particionar en 'aridad'
+static double buffersEscritor(const ParametrosQuick *p, int aridad) {
+    double bloques = floor((double)bloquesEnMemoriaConfig(p->cfg) / (2.0 * aridad));
+    if (bloques > p->bloquesSalida) bloques = p->bloquesSalida;
+    return (bloques < 1) ? 1 : bloques;
+}
+
+//generador propio (xorshift64*), para no mover la secuencia de rand() del programa
+static double uniformeModelo(uint64_t *estado) {
+    *estado ^= *estado >> 12;
+    *estado ^= *estado << 25;
+    *estado ^= *estado >> 27;
+    return ((*estado * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//exponencial(1): sus sumas normalizadas son los espaciados de a-1 pivotes uniformes
+static double exponencialModelo(uint64_t *estado) {
+    return -log(1.0 - uniformeModelo(estado));
+}
+
+//gamma(SOBREMUESTREO_QUICK): con pivotes equiespaciados en la muestra cada particion
+//junta los espaciados de SOBREMUESTREO_QUICK claves
+static double gammaModelo(uint64_t *estado) {
+    double suma = 0;
+    for (int k = 0; k < SOBREMUESTREO_QUICK; k++) {
+        suma += exponencialModelo(estado);
+    }
+    return suma;
+}
+
+/*
+suma a prediccion el costo de ordenar una particion de 'tamaño' elementos: si no cabe
+en memoria, la lee para particionarla (mas los bloques de la muestra de pivotes),
+escribe las particiones (cada una con un bloque a medias), las ordena y, sin colocacion directa,
+las vuelve a leer y escribir al concatenar; si cabe, se lee, ordena y escribe una
+vez (en su tramo de la salida, si hay colocacion directa). los tamaños de
+las particiones salen de pivotes sobremuestreados, como en seleccionarPivotes
+return: niveles de particion bajo este nodo
+*/
+static int simularParticion(const ParametrosQuick *p, double tamaño, uint64_t *estado,
+                            PrediccionCosto *prediccion) {
+    double bloques = bloquesDe(p->cfg, tamaño);
+    if (tamaño <= p->enMemoria) {
+        prediccion->accesos += 2 * bloques;
+        prediccion->solicitudes += 2 * ceil(bloques / p->bloquesCopia);
+        prediccion->comparaciones += ordenarEnMemoria(tamaño);
+        return 0;
+    }
+    int aridad = aridadDeNivel((size_t)tamaño, p->aridad, p->cfg);
+    double muestra = (double)bloquesMuestraPivotes((size_t)tamaño, aridad - 1, p->cfg);
+    prediccion->accesos += 2 * bloques + aridad + muestra;
+    prediccion->solicitudes += bloques / p->bloquesLector + bloques / buffersEscritor(p, aridad) + aridad + muestra;
+    if (!p->cfg->colocacionDirecta) {
+        //concatenar las particiones ordenadas
+        prediccion->accesos += 2 * bloques;
+        prediccion->solicitudes += bloques / bloquesAcotados(p->cfg, (size_t)p->bloquesCopia, FRACCION_COPIA) +
+                                   bloques / bloquesAcotados(p->cfg, (size_t)p->bloquesSalida, FRACCION_COPIA);
+    }
+    //cada elemento busca su particion con busqueda binaria entre los pivotes
+    prediccion->comparaciones += tamaño * log2(aridad);
+
+    //dos vueltas con la misma semilla: la primera suma, la segunda reparte
+    uint64_t inicio = *estado;
+    double total = 0;
+    for (int i = 0; i < aridad; i++) {
+        total += gammaModelo(estado);
+    }
+    uint64_t siguiente = *estado;
+    *estado = inicio;
+    int niveles = 0;
+    double restantes = tamaño;
+    for (int i = 0; i < aridad; i++) {
+        double parte = (i == aridad - 1) ? restantes : floor(tamaño * gammaModelo(estado) / total);
+        if (parte > restantes) {
+            parte = restantes;
+        }
+        restantes -= parte;
+        if (parte > 0) {
+            uint64_t hijo = siguiente + (uint64_t)i * 0x9E3779B97F4A7C15ULL;
+            int bajo = simularParticion(p, parte, &hijo, prediccion);
+            if (bajo > niveles) {
+                niveles = bajo;
+            }
+        }
+    }
+    *estado = siguiente;
+    return niveles + 1;
+}
+
+/*
+predice el costo de quicksortExternoCon: con pivotes muestreados las particiones no
+miden exactamente 1/aridad del padre, y las que quedan mas grandes que M necesitan
+otro nivel (cada uno con la aridad de aridadDeNivel), asi que se promedian
+SIMULACION_ARBOLES arboles de particion con
+tamaños al azar (sin datos, solo los tamaños, con semilla fija para que la
+prediccion sea reproducible)
+cfg: configuracion del ordenamiento
+numElementos: N
+aridad: particiones por nivel
+calibracion: costos medidos
+prediccion: aqui se deja el costo predicho
+*/
+void predecirQuicksort(const ConfigOrden *cfg, size_t numElementos, int aridad,
+                       const CalibracionCosto *calibracion, PrediccionCosto *prediccion) {
+    ParametrosQuick p;
+    p.cfg = cfg;
+    p.aridad = aridad;
+    p.enMemoria = (double)elementosEnMemoriaConfig(cfg);
+    p.bloquesSalida = (double)bloquesDeTrozo(cfg->tamBloque, ESCRITOR_BLOQUES);
+    p.bloquesLector = (double)bloquesDeTrozo(cfg->tamBloque, LECTOR_BLOQUES);
+    p.bloquesCopia = (double)bloquesDeTrozo(cfg->tamBloque, COPIA_BLOQUES);
+
+    PrediccionCosto suma = {0};
+    double niveles = 0;
+    for (int arbol = 0; arbol < SIMULACION_ARBOLES; arbol++) {
+        uint64_t estado = 0x2545F4914F6CDD1DULL + (uint64_t)arbol * 0x9E3779B97F4A7C15ULL;
+        niveles += simularParticion(&p, (double)numElementos, &estado, &suma);
+    }
+    prediccion->accesos = suma.accesos / SIMULACION_ARBOLES;
+    prediccion->solicitudes = suma.solicitudes / SIMULACION_ARBOLES;
+    prediccion->comparaciones = suma.comparaciones / SIMULACION_ARBOLES;
+    prediccion->nivelesHeap = 0;
+    prediccion->niveles = (int)ceil(niveles / SIMULACION_ARBOLES);
+    completarPrediccion(calibracion, prediccion);
+}
+
+/*
+elige la aridad de mergesort con menor tiempo predicho entre 2 y calcularMaxAridad
+(con tiempos iguales la de menos accesos, y luego la menor); solo evalua el modelo,
+asi que toma microsegundos
+cfg: configuracion del ordenamiento
+numElementos: N
+calibracion: costos medidos
+prediccion: aqui se deja el costo predicho de la aridad elegida (puede ser NULL)
+return: aridad elegida
+*/
+int planificarAridad(const ConfigOrden *cfg, size_t numElementos, const CalibracionCosto *calibracion,
+                     PrediccionCosto *prediccion) {
+    int maxAridad = calcularMaxAridad(cfg);
+    int mejor = 2;
+    PrediccionCosto mejorPrediccion;
+    predecirMergesort(cfg, numElementos, 2, calibracion, &mejorPrediccion);
+    for (int aridad = 3; aridad <= maxAridad; aridad++) {
+        PrediccionCosto actual;
+        predecirMergesort(cfg, numElementos, aridad, calibracion, &actual);
+        if (actual.segundos < mejorPrediccion.segundos ||
+            (actual.segundos == mejorPrediccion.segundos && actual.accesos < mejorPrediccion.accesos)) {
+            mejor = aridad;
+            mejorPrediccion = actual;
+        }
+    }
+    if (prediccion) {
+        *prediccion = mejorPrediccion;
+    }
+    return mejor;
+}
@@ -0,0 +1,44 @@
+#ifndef MODELO_H
+#define MODELO_H
+
+#include "config.h"
+
+#define CALIBRACION_BLOQUES 2048  //bloques del archivo con que se mide el costo de I/O
+#define CALIBRACION_ELEMENTOS (1 << 18)  //elementos que se ordenan para medir una comparacion
+#define CALIBRACION_TROZO 64  //bloques por lectura en la medicion con lecturas grandes
+#define CALIBRACION_HEAP (1 << 21)  //elementos del heap con que se mide la seleccion por reemplazo
+#define SIMULACION_ARBOLES 16  //arboles de particion al azar que promedia el modelo de quicksort
+
+//costos medidos del equipo, con ellos el modelo pasa de accesos a segundos (todos
+//con reloj real, como tiempoEjecucion)
+typedef struct {
+    double segundosPorSolicitud;   //costo fijo de cada lectura o escritura al disco
+    double segundosPorBloque;      //transferencia de un bloque de B bytes
+    double segundosPorComparacion; //una comparacion (con su movimiento) al ordenar o mezclar
+    double segundosPorNivelHeap;   //bajar un nivel en un heap grande (fallos de cache incluidos)
+} CalibracionCosto;
+
+//costo predicho de un ordenamiento externo
+typedef struct {
+    double accesos;       //bloques leidos y escritos
+    double solicitudes;   //lecturas y escrituras al disco (de uno o varios bloques)
+    double comparaciones;
+    double nivelesHeap;   //niveles que se bajan en el heap al generar runs
+    double segundos;      //de reloj real, comparable con tiempoEjecucion
+    int niveles;          //pasadas de mezcla (mergesort) o niveles de particion (quicksort)
+} PrediccionCosto;
+
+//calibracion con un microbenchmark corto
+int calibrarCosto(const ConfigOrden *cfg, CalibracionCosto *calibracion);
+
+//modelo de costo de cada algoritmo
+void predecirMergesort(const ConfigOrden *cfg, size_t numElementos, int aridad,
+                       const CalibracionCosto *calibracion, PrediccionCosto *prediccion);
+void predecirQuicksort(const ConfigOrden *cfg, size_t numElementos, int aridad,
+                       const CalibracionCosto *calibracion, PrediccionCosto *prediccion);
+
+//aridad con menor tiempo predicho
+int planificarAridad(const ConfigOrden *cfg, size_t numElementos, const CalibracionCosto *calibracion,
+                     PrediccionCosto *prediccion);
+
+#endif
@@ -0,0 +1,277 @@
+#include "paralelo.h"
+#include "merge.h"
+#include "radix.h"
+#include "simd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+//trabajo de un hilo al ordenar su tramo
+typedef struct {
+    int64_t *arreglo;
+    size_t n;
+    int64_t *aux;
+    size_t tamAux;
+    OrdenEnMemoria orden;
+    int resultado;
+} TareaOrden;
+
+//trabajo de un hilo en una mezcla repartida: el tramo [desde, hasta) de la salida
+typedef struct {
+    const int64_t *a;
+    size_t na;
+    const int64_t *b;
+    size_t nb;
+    int64_t *destino;
+    size_t desde;
+    size_t hasta;
+} TareaMezcla;
+
+static void *ejecutarTareaOrden(void *arg) {
+    TareaOrden *tarea = arg;
+    tarea->resultado = tarea->orden(tarea->arreglo, tarea->n, tarea->aux, tarea->tamAux);
+    return NULL;
+}
+
+static void *ejecutarTareaMezcla(void *arg) {
+    TareaMezcla *tarea = arg;
+    size_t i0 = dividirMezcla(tarea->a, tarea->na, tarea->b, tarea->nb, tarea->desde);
+    size_t i1 = dividirMezcla(tarea->a, tarea->na, tarea->b, tarea->nb, tarea->hasta);
+    size_t j0 = tarea->desde - i0;
+    size_t j1 = tarea->hasta - i1;
+    mezclarOrdenados(tarea->a + i0, i1 - i0, tarea->b + j0, j1 - j0, tarea->destino + tarea->desde);
+    return NULL;
+}
+
+//cola de tareas compartida por los hilos de ejecutarEnPool
+typedef struct {
+    void *(*funcion)(void *);
+    char *tareas;
+    size_t tamTarea;
+    int numTareas;
+    int siguiente; //proxima tarea sin tomar
+} ColaTareas;
+
+static void *trabajarCola(void *arg) {
+    ColaTareas *cola = arg;
+    while (1) {
+        int t = __atomic_fetch_add(&cola->siguiente, 1, __ATOMIC_RELAXED);
+        if (t >= cola->numTareas) {
+            return NULL;
+        }
+        cola->funcion(cola->tareas + (size_t)t * cola->tamTarea);
+    }
+}
+
+/*
+corre numTareas tareas con a lo mas 'hilos' hilos: cada hilo toma la siguiente tarea
+libre hasta que no quedan; el que llama tambien trabaja, y si no se puede crear un
+hilo sus tareas las toman los demas
+funcion: trabajo de cada tarea
+tareas: arreglo de tareas
+tamTarea: bytes de cada tarea
+numTareas: cantidad de tareas
+hilos: hilos a usar (contando el que llama)
+*/
+void ejecutarEnPool(void *(*funcion)(void *), void *tareas, size_t tamTarea, int numTareas, int hilos) {
+    ColaTareas cola = {funcion, tareas, tamTarea, numTareas, 0};
+    if (hilos > numTareas) {
+        hilos = numTareas;
+    }
+    pthread_t *ids = (hilos > 1) ? malloc(hilos * sizeof(pthread_t)) : NULL;
+    int creados = 0;
+    for (int h = 1; h < hilos && ids; h++) {
+        if (pthread_create(&ids[creados], NULL, trabajarCola, &cola) == 0) {
+            creados++;
+        }
+    }
+    trabajarCola(&cola);
+    for (int h = 0; h < creados; h++) {
+        pthread_join(ids[h], NULL);
+    }
+    free(ids);
+}
+
+/*
+busca donde corta la diagonal 'diagonal' el camino de la mezcla de a y b (merge path):
+los primeros 'diagonal' elementos de la salida son a[0, i) y b[0, diagonal - i)
+a: primera secuencia ordenada
+na: elementos de a
+b: segunda secuencia ordenada
+nb: elementos de b
+diagonal: posicion en la salida, entre 0 y na + nb
+return: i, cantidad de elementos que vienen de a (con claves iguales a va primero)
+*/
+size_t dividirMezcla(const int64_t *a, size_t na, const int64_t *b, size_t nb, size_t diagonal) {
+    size_t bajo = (diagonal > nb) ? diagonal - nb : 0;
+    size_t alto = (diagonal < na) ? diagonal : na;
+    while (bajo < alto) {
+        size_t mitad = bajo + (alto - bajo) / 2;
+        if (a[mitad] <= b[diagonal - mitad - 1]) {
+            bajo = mitad + 1;
+        } else {
+            alto = mitad;
+        }
+    }
+    return bajo;
+}
+
+/*
+mezcla dos secuencias ordenadas repartiendo la salida en tramos iguales entre hilos;
+cada hilo ubica su tramo con dividirMezcla y lo mezcla con los kernels de simd.c
+a: primera secuencia
+na: elementos de a
+b: segunda secuencia
+nb: elementos de b
+destino: donde dejar los na + nb elementos (sin solaparse con a ni b)
+hilos: hilos a usar
+return: 0 si exito, -1 si error
+*/
+int mezclarParalelo(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *destino, int hilos) {
+    size_t total = na + nb;
+    if ((size_t)hilos > total / MINIMO_POR_HILO) {
+        hilos = (int)(total / MINIMO_POR_HILO);
+    }
+    if (hilos <= 1) {
+        mezclarOrdenados(a, na, b, nb, destino);
+        return 0;
+    }
+
+    TareaMezcla *tareas = malloc(hilos * sizeof(TareaMezcla));
+    if (!tareas) {
+        mezclarOrdenados(a, na, b, nb, destino);
+        return 0;
+    }
+    for (int t = 0; t < hilos; t++) {
+        tareas[t].a = a;
+        tareas[t].na = na;
+        tareas[t].b = b;
+        tareas[t].nb = nb;
+        tareas[t].destino = destino;
+        tareas[t].desde = total * t / hilos;
+        tareas[t].hasta = total * (t + 1) / hilos;
+    }
+    ejecutarEnPool(ejecutarTareaMezcla, tareas, sizeof(TareaMezcla), hilos, hilos);
+    free(tareas);
+    return 0;
+}
+
+/*
+ordena en memoria con varios hilos: cada hilo ordena un tramo con 'orden' y luego
+los tramos se mezclan de a pares. si aux alcanza para n elementos las mezclas van
+de un arreglo al otro y cada una se reparte entre todos los hilos; si no, se mezcla
+en el lugar con lo que quepa en aux (sin pasarse de la memoria dada)
+arreglo: arreglo a ordenar
+n: cantidad de elementos
+aux: arreglo auxiliar, puede ser NULL si tamAux es 0
+tamAux: elementos disponibles en aux
+hilos: hilos a usar (1 para ordenar en el hilo que llama)
+orden: ordenamiento de cada tramo
+return: 0 si exito, -1 si error
+*/
+int ordenarParalelo(int64_t *arreglo, size_t n, int64_t *aux, size_t tamAux, int hilos,
+                    OrdenEnMemoria orden) {
+    if ((size_t)hilos > n / MINIMO_POR_HILO) {
+        hilos = (int)(n / MINIMO_POR_HILO);
+    }
+    if (hilos <= 1) {
+        return orden(arreglo, n, aux, tamAux);
+    }
+
+    TareaOrden *tareas = malloc(hilos * sizeof(TareaOrden));
+    size_t *limites = malloc((hilos + 1) * sizeof(size_t));
+    if (!tareas || !limites) {
+        free(tareas);
+        free(limites);
+        return orden(arreglo, n, aux, tamAux);
+    }
+
+    //fase 1: cada hilo ordena su tramo con su parte del auxiliar
+    int mezclaFuera = (tamAux >= n);
+    size_t auxPorHilo = tamAux / hilos;
+    for (int t = 0; t <= hilos; t++) {
+        limites[t] = n * t / hilos;
+    }
+    for (int t = 0; t < hilos; t++) {
+        tareas[t].arreglo = arreglo + limites[t];
+        tareas[t].n = limites[t + 1] - limites[t];
+        if (mezclaFuera) {
+            tareas[t].aux = aux + limites[t];
+            tareas[t].tamAux = tareas[t].n;
+        } else {
+            tareas[t].aux = (auxPorHilo > 0) ? aux + t * auxPorHilo : NULL;
+            tareas[t].tamAux = auxPorHilo;
+        }
+        tareas[t].orden = orden;
+        tareas[t].resultado = 0;
+    }
+    ejecutarEnPool(ejecutarTareaOrden, tareas, sizeof(TareaOrden), hilos, hilos);
+
+    int resultado = 0;
+    for (int t = 0; t < hilos; t++) {
+        if (tareas[t].resultado != 0) {
+            resultado = -1;
+        }
+    }
+    free(tareas);
+    if (resultado != 0) {
+        free(limites);
+        return -1;
+    }
+
+    //fase 2: rondas de mezclas de a pares hasta dejar un solo tramo
+    int64_t *origen = arreglo;
+    int64_t *destino = aux;
+    int tramos = hilos;
+    while (tramos > 1) {
+        int nuevos = 0;
+        for (int i = 0; i < tramos; i += 2) {
+            size_t inicio = limites[i];
+            size_t medio = limites[(i + 1 < tramos) ? i + 1 : tramos];
+            size_t fin = limites[(i + 2 < tramos) ? i + 2 : tramos];
+            if (mezclaFuera) {
+                if (medio < fin) {
+                    mezclarParalelo(origen + inicio, medio - inicio, origen + medio, fin - medio,
+                                    destino + inicio, hilos);
+                } else {
+                    //tramo sin pareja en esta ronda
+                    memcpy(destino + inicio, origen + inicio, (fin - inicio) * sizeof(int64_t));
+                }
+            } else if (medio < fin) {
+                mezclarConBuffer(arreglo + inicio, medio - inicio, fin - inicio, aux, tamAux);
+            }
+            limites[nuevos++] = inicio;
+        }
+        limites[nuevos] = n;
+        tramos = nuevos;
+        if (mezclaFuera) {
+            int64_t *temp = origen;
+            origen = destino;
+            destino = temp;
+        }
+    }
+    if (origen != arreglo) {
+        memcpy(arreglo, origen, n * sizeof(int64_t));
+    }
+
+    free(limites);
+    return 0;
+}
+
+/*
+ordena en memoria segun la configuracion: radix sort si cfg->motor lo pide o el
+ordenamiento por comparacion del algoritmo que llama, con cfg->hilos hilos
+cfg: configuracion del ordenamiento
+arreglo: arreglo a ordenar
+n: cantidad de elementos
+aux: arreglo auxiliar, puede ser NULL si tamAux es 0
+tamAux: elementos disponibles en aux
+porComparacion: ordenamiento por comparacion del algoritmo (mergesort o quicksort)
+return: 0 si exito, -1 si error
+*/
+int ordenarEnMemoriaCon(const ConfigOrden *cfg, int64_t *arreglo, size_t n, int64_t *aux, size_t tamAux,
+                        OrdenEnMemoria porComparacion) {
+    OrdenEnMemoria orden = (cfg->motor == MOTOR_RADIX) ? radixSortCon : porComparacion;
+    return ordenarParalelo(arreglo, n, aux, tamAux, cfg->hilos, orden);
+}
@@ -0,0 +1,26 @@
+#ifndef PARALELO_H
+#define PARALELO_H
+
+#include "config.h"
+#include <stdint.h>
+
+#define MINIMO_POR_HILO 65536  //elementos minimos por hilo para que convenga repartir
+
+//ordenamiento en memoria de una hoja: ordena arreglo usando a lo mas tamAux
+//elementos de aux (aux puede ser NULL si tamAux es 0)
+typedef int (*OrdenEnMemoria)(int64_t *arreglo, size_t n, int64_t *aux, size_t tamAux);
+
+//pool de hilos para tareas independientes
+void ejecutarEnPool(void *(*funcion)(void *), void *tareas, size_t tamTarea, int numTareas, int hilos);
+
+//ordenamiento en memoria con varios hilos
+int ordenarEnMemoriaCon(const ConfigOrden *cfg, int64_t *arreglo, size_t n, int64_t *aux, size_t tamAux,
+                        OrdenEnMemoria porComparacion);
+int ordenarParalelo(int64_t *arreglo, size_t n, int64_t *aux, size_t tamAux, int hilos,
+                    OrdenEnMemoria orden);
+
+//mezcla de dos secuencias repartida entre hilos
+size_t dividirMezcla(const int64_t *a, size_t na, const int64_t *b, size_t nb, size_t diagonal);
+int mezclarParalelo(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *destino, int hilos);
+
+#endif
@@ -0,0 +1,174 @@
+#include "perfil.h"
+#include "simd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define LINEA_PERFIL 512
+//todos los costos se miden con reloj real; un archivo con otro encabezado (de antes,
+//con tiempos de CPU) no se usa y se reemplaza al guardar
+#define ENCABEZADO_PERFIL "dispositivo,cpus,simd,backend,bloque,memoria,hilos,aridadPorNivel,log2N,aridad,origen," \
+                          "segundosRealesPorSolicitud,segundosRealesPorBloque,segundosRealesPorComparacion," \
+                          "segundosRealesPorNivelHeap\n"
+
+/*
+llena la clave del perfil para ordenar numElementos con cfg en este equipo
+cfg: configuracion del ordenamiento
+numElementos: N
+perfil: perfil cuya clave se llena (los valores no se tocan)
+*/
+void clavePerfil(const ConfigOrden *cfg, size_t numElementos, PerfilAjuste *perfil) {
+    struct stat info;
+    perfil->dispositivo = (stat(".", &info) == 0) ? (unsigned long long)info.st_dev : 0;
+    perfil->cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    perfil->simd = kernelsSimdActivos();
+    perfil->backend = (int)cfg->backend;
+    perfil->tamBloque = cfg->tamBloque;
+    perfil->memoria = cfg->memoria;
+    perfil->hilos = cfg->hilos;
+    perfil->aridadPorNivel = cfg->aridadPorNivel;
+    perfil->escalaN = 0;
+    while (numElementos > 1) {
+        numElementos >>= 1;
+        perfil->escalaN++;
+    }
+    perfil->guardado = 0;
+}
+
+//1 si a y b tienen la misma clave
+static int mismaClave(const PerfilAjuste *a, const PerfilAjuste *b) {
+    return a->dispositivo == b->dispositivo && a->cpus == b->cpus && a->simd == b->simd &&
+           a->backend == b->backend && a->tamBloque == b->tamBloque && a->memoria == b->memoria &&
+           a->hilos == b->hilos && a->aridadPorNivel == b->aridadPorNivel && a->escalaN == b->escalaN;
+}
+
+//lee una linea del archivo de perfiles; return: 0 si es un perfil valido, -1 si no
+static int parsearPerfil(const char *linea, PerfilAjuste *perfil) {
+    CalibracionCosto *c = &perfil->calibracion;
+    int campos = sscanf(linea, "%llu,%d,%d,%d,%zu,%zu,%d,%d,%d,%d,%15[^,],%lg,%lg,%lg,%lg",
+                        &perfil->dispositivo, &perfil->cpus, &perfil->simd, &perfil->backend,
+                        &perfil->tamBloque, &perfil->memoria, &perfil->hilos, &perfil->aridadPorNivel, &perfil->escalaN,
+                        &perfil->aridad, perfil->origen, &c->segundosPorSolicitud, &c->segundosPorBloque,
+                        &c->segundosPorComparacion, &c->segundosPorNivelHeap);
+    return (campos == 15 && perfil->aridad >= 2) ? 0 : -1;
+}
+
+static void escribirPerfil(FILE *archivo, const PerfilAjuste *perfil) {
+    const CalibracionCosto *c = &perfil->calibracion;
+    fprintf(archivo, "%llu,%d,%d,%d,%zu,%zu,%d,%d,%d,%d,%s,%.6e,%.6e,%.6e,%.6e\n",
+            perfil->dispositivo, perfil->cpus, perfil->simd, perfil->backend, perfil->tamBloque,
+            perfil->memoria, perfil->hilos, perfil->aridadPorNivel, perfil->escalaN, perfil->aridad, perfil->origen,
+            c->segundosPorSolicitud, c->segundosPorBloque, c->segundosPorComparacion, c->segundosPorNivelHeap);
+}
+
+//abre el archivo de perfiles para leer, solo si tiene el encabezado actual
+static FILE *abrirPerfiles(const char *archivo) {
+    FILE *entrada = fopen(archivo, "r");
+    if (!entrada) {
+        return NULL;
+    }
+    char linea[LINEA_PERFIL];
+    if (!fgets(linea, sizeof(linea), entrada) || strcmp(linea, ENCABEZADO_PERFIL) != 0) {
+        fclose(entrada);
+        return NULL;
+    }
+    return entrada;
+}
+
+/*
+busca en el archivo un perfil con la clave de perfil
+archivo: archivo de perfiles
+perfil: con la clave llena (clavePerfil); si se encuentra se le copian los valores
+return: 0 si se encontro, -1 si no (o si no hay archivo)
+*/
+int leerPerfil(const char *archivo, PerfilAjuste *perfil) {
+    FILE *entrada = abrirPerfiles(archivo);
+    if (!entrada) {
+        return -1;
+    }
+    char linea[LINEA_PERFIL];
+    int encontrado = -1;
+    while (encontrado != 0 && fgets(linea, sizeof(linea), entrada)) {
+        PerfilAjuste leido;
+        if (parsearPerfil(linea, &leido) == 0 && mismaClave(&leido, perfil)) {
+            *perfil = leido;
+            perfil->guardado = 1;
+            encontrado = 0;
+        }
+    }
+    fclose(entrada);
+    return encontrado;
+}
+
+/*
+guarda el perfil en el archivo, reemplazando el que tenga su misma clave; se escribe
+a un temporal que luego se renombra, para no dejar el archivo a medias
+archivo: archivo de perfiles
+perfil: perfil a guardar
+return: 0 si exito, -1 si error
+*/
+int guardarPerfil(const char *archivo, const PerfilAjuste *perfil) {
+    char temporal[256];
+    snprintf(temporal, sizeof(temporal), "%s.%d", archivo, (int)getpid());
+    FILE *salida = fopen(temporal, "w");
+    if (!salida) {
+        printf("Error: no se pudo escribir el perfil %s\n", temporal);
+        return -1;
+    }
+    fputs(ENCABEZADO_PERFIL, salida);
+
+    //los demas perfiles se mantienen
+    FILE *entrada = abrirPerfiles(archivo);
+    if (entrada) {
+        char linea[LINEA_PERFIL];
+        while (fgets(linea, sizeof(linea), entrada)) {
+            PerfilAjuste leido;
+            if (parsearPerfil(linea, &leido) == 0 && !mismaClave(&leido, perfil)) {
+                fputs(linea, salida);
+            }
+        }
+        fclose(entrada);
+    }
+    escribirPerfil(salida, perfil);
+    if (fclose(salida) != 0 || rename(temporal, archivo) != 0) {
+        printf("Error: no se pudo guardar el perfil %s\n", archivo);
+        remove(temporal);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+aridad de mergesort para ordenar numElementos con cfg: si ARCHIVO_PERFIL tiene un
+perfil con la misma clave se usa al instante; si no, se calibra el modelo de costo,
+se planifica la aridad y se guarda el perfil para las ejecuciones siguientes
+cfg: configuracion del ordenamiento
+numElementos: N
+reajustar: 1 para ignorar el perfil guardado y volver a medir
+perfil: aqui se deja el perfil usado (puede ser NULL)
+return: aridad, -1 si error
+*/
+int aridadAjustada(const ConfigOrden *cfg, size_t numElementos, int reajustar, PerfilAjuste *perfil) {
+    PerfilAjuste propio;
+    if (!perfil) {
+        perfil = &propio;
+    }
+    if (prepararConfig(cfg) != 0) {
+        return -1;
+    }
+    clavePerfil(cfg, numElementos, perfil);
+    if (!reajustar && leerPerfil(ARCHIVO_PERFIL, perfil) == 0) {
+        return perfil->aridad;
+    }
+
+    if (calibrarCosto(cfg, &perfil->calibracion) != 0) {
+        printf("Error: no se pudo calibrar el modelo de costo\n");
+        return -1;
+    }
+    perfil->aridad = planificarAridad(cfg, numElementos, &perfil->calibracion, NULL);
+    snprintf(perfil->origen, sizeof(perfil->origen), "modelo");
+    guardarPerfil(ARCHIVO_PERFIL, perfil);
+    return perfil->aridad;
+}
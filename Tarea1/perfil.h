@@ -0,0 +1,36 @@
+#ifndef PERFIL_H
+#define PERFIL_H
+
+#include "config.h"
+#include "modelo.h"
+
+#define ARCHIVO_PERFIL "perfil_ordenamiento.csv"  //perfiles de ajuste guardados entre ejecuciones
+
+//resultado de ajustar los ordenamientos en un equipo, con la clave que lo identifica
+typedef struct {
+    //clave: si cambia el equipo o los parametros hay que volver a ajustar
+    unsigned long long dispositivo; //dispositivo del directorio de trabajo (donde van los archivos)
+    int cpus;
+    int simd;                       //kernels AVX2 activos
+    int backend;
+    size_t tamBloque;
+    size_t memoria;
+    int hilos;
+    int aridadPorNivel;
+    int escalaN;                    //floor(log2 N): N parecidos comparten perfil
+
+    //valores
+    int aridad;
+    char origen[16];                //"modelo" o "busqueda" (aridad medida ordenando)
+    CalibracionCosto calibracion;   //costo real por solicitud y por bloque, y costo de CPU de la mezcla
+    int guardado;                   //1 si se leyo del archivo en vez de medirlo
+} PerfilAjuste;
+
+void clavePerfil(const ConfigOrden *cfg, size_t numElementos, PerfilAjuste *perfil);
+int leerPerfil(const char *archivo, PerfilAjuste *perfil);
+int guardarPerfil(const char *archivo, const PerfilAjuste *perfil);
+
+//aridad para ordenar N elementos con cfg, del perfil guardado o calibrando si no hay
+int aridadAjustada(const ConfigOrden *cfg, size_t numElementos, int reajustar, PerfilAjuste *perfil);
+
+#endif
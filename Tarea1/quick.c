@@ -1,11 +1,13 @@
 #include "quick.h"
+#include "simd.h"
+#include "paralelo.h"
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <math.h>
 
 /*
-implementa quicksort externo principal
+implementa quicksort externo principal con B y M por defecto
 archivoEntrada: archivo binario con datos desordenados
 archivoSalida: archivo binario donde guardar resultado ordenado
 numElementos: cantidad de elementos en el archivo
@@ -15,145 +17,368 @@ return: 0 si exito, -1 si error
 */
 int quicksortExterno(const char *archivoEntrada, const char *archivoSalida,
                      size_t numElementos, int aridad, EstadisticasQuick *stats) {
+    ConfigOrden cfg = configPorDefecto();
+    return quicksortExternoCon(archivoEntrada, archivoSalida, numElementos, aridad, &cfg, stats);
+}
+
+//quicksortClasico con la firma de las hojas de ordenarEnMemoriaCon (no usa aux)
+static int quicksortHoja(int64_t *arreglo, size_t n, int64_t *aux, size_t tamAux) {
+    (void)aux;
+    (void)tamAux;
+    return quicksortClasico(arreglo, n);
+}
+
+/*
+caso base del quicksort externo: carga la entrada, la ordena en memoria y la escribe
+en la salida; ambas pueden ser vistas (abrirVista) y la misma vista
+entrada: archivo o vista con los datos desordenados
+salida: archivo o vista donde dejar el resultado ordenado
+numElementos: cantidad de elementos a ordenar
+cfg: tamaño de bloque, memoria, backend y motor
+return: 0 si exito, -1 si error
+*/
+static int ordenarHojaEnMemoria(ArchivoBin *entrada, ArchivoBin *salida,
+                                size_t numElementos, const ConfigOrden *cfg) {
+    int64_t *arreglo = malloc(numElementos * sizeof(int64_t));
+    if (!arreglo) {
+        printf("Error: no se pudo allocar memoria para ordenar\n");
+        return -1;
+    }
+    if (leerRango(entrada, 0, numElementos, arreglo) != 0) {
+        free(arreglo);
+        return -1;
+    }
+
+    //ordenar en memoria; radix sort y la mezcla de los tramos de cada hilo usan
+    //como auxiliar lo que queda de M
+    printf("  Ordenando %zu elementos en memoria\n", numElementos);
+    size_t tamAux = 0;
+    if (cfg->motor == MOTOR_RADIX || cfg->hilos > 1) {
+        tamAux = auxiliarEnMemoriaConfig(cfg, numElementos);
+    }
+    int64_t *aux = (tamAux > 0) ? malloc(tamAux * sizeof(int64_t)) : NULL;
+    ordenarEnMemoriaCon(cfg, arreglo, numElementos, aux, aux ? tamAux : 0, quicksortHoja);
+    free(aux);
+
+    int resultado = escribirRango(salida, 0, numElementos, arreglo);
+    free(arreglo);
+    return resultado;
+}
+
+/*
+ordena en memoria un archivo que cabe en M y lo deja en el archivo de salida (que
+puede ser el mismo)
+archivoEntrada: archivo con los datos desordenados
+archivoSalida: archivo donde guardar el resultado
+numElementos: cantidad de elementos
+cfg: tamaño de bloque, memoria, backend y motor
+return: 0 si exito, -1 si error
+*/
+static int ordenarHojaEnArchivo(const char *archivoEntrada, const char *archivoSalida,
+                                size_t numElementos, const ConfigOrden *cfg) {
+    //si se ordena en lugar se abre una sola vez, porque "wb" truncaria la entrada
+    OpcionesArchivo opciones = opcionesDeConfig(cfg);
+    int enLugar = strcmp(archivoEntrada, archivoSalida) == 0;
+    ArchivoBin entrada;
+    if (abrirArchivoCon(&entrada, archivoEntrada, enLugar ? "r+b" : "rb", &opciones) != 0) {
+        return -1;
+    }
+    ArchivoBin salida;
+    if (!enLugar && abrirArchivoCon(&salida, archivoSalida, "wb", &opciones) != 0) {
+        cerrarArchivo(&entrada);
+        return -1;
+    }
+    int resultado = ordenarHojaEnMemoria(&entrada, enLugar ? &entrada : &salida,
+                                         numElementos, cfg);
+    cerrarArchivo(&entrada);
+    if (!enLugar) {
+        cerrarArchivo(&salida);
+    }
+    return resultado;
+}
+
+/*
+ordena en memoria un archivo que cabe en M y deja el resultado en un tramo del
+archivo de salida, abierto como vista (ya debe existir)
+archivoEntrada: archivo con los datos desordenados
+archivoSalida: archivo donde va el resultado
+inicioSalida: posicion de la salida donde va el primer elemento
+numElementos: cantidad de elementos
+cfg: tamaño de bloque, memoria, backend y motor
+return: 0 si exito, -1 si error
+*/
+static int ordenarHojaEnSalida(const char *archivoEntrada, const char *archivoSalida,
+                               size_t inicioSalida, size_t numElementos, const ConfigOrden *cfg) {
+    OpcionesArchivo opciones = opcionesDeConfig(cfg);
+    ArchivoBin entrada;
+    if (abrirArchivoCon(&entrada, archivoEntrada, "rb", &opciones) != 0) {
+        return -1;
+    }
+    ArchivoBin salida;
+    if (abrirVista(&salida, archivoSalida, "r+b", inicioSalida, numElementos, &opciones) != 0) {
+        cerrarArchivo(&entrada);
+        return -1;
+    }
+    int resultado = ordenarHojaEnMemoria(&entrada, &salida, numElementos, cfg);
+    cerrarArchivo(&entrada);
+    cerrarArchivo(&salida);
+    return resultado;
+}
+
+/*
+escribe la cubeta de igualdad de un pivote (cantidad copias de valor) en un tramo
+del archivo de salida, abierto como vista (ya debe existir)
+archivoSalida: archivo donde va el resultado
+inicioSalida: posicion de la salida donde va la primera copia
+valor: pivote
+cantidad: elementos iguales al pivote
+cfg: tamaño de bloque, memoria y backend
+return: 0 si exito, -1 si error
+*/
+static int escribirIguales(const char *archivoSalida, size_t inicioSalida, int64_t valor,
+                           size_t cantidad, const ConfigOrden *cfg) {
+    OpcionesArchivo opciones = opcionesDeConfig(cfg);
+    ArchivoBin salida;
+    if (abrirVista(&salida, archivoSalida, "r+b", inicioSalida, cantidad, &opciones) != 0) {
+        return -1;
+    }
+    size_t tamTrozo = bloquesAcotadosConfig(cfg, bloquesDeTrozo(cfg->tamBloque, COPIA_BLOQUES), FRACCION_COPIA) *
+                      elementosPorBloqueConfig(cfg);
+    if (tamTrozo > cantidad) {
+        tamTrozo = cantidad;
+    }
+    int64_t *trozo = malloc(tamTrozo * sizeof(int64_t));
+    if (!trozo) {
+        cerrarArchivo(&salida);
+        return -1;
+    }
+    for (size_t i = 0; i < tamTrozo; i++) {
+        trozo[i] = valor;
+    }
+    
+    int resultado = 0;
+    for (size_t escritos = 0; escritos < cantidad && resultado == 0; escritos += tamTrozo) {
+        size_t n = (cantidad - escritos < tamTrozo) ? cantidad - escritos : tamTrozo;
+        resultado = escribirRango(&salida, escritos, n, trozo);
+    }
+    free(trozo);
+    cerrarArchivo(&salida);
+    return resultado;
+}
+
+/*
+caso recursivo del quicksort externo: particiona la entrada en archivos temporales
+segun a-1 pivotes y ordena cada particion. con cfg->colocacionDirecta cada particion
+se ordena directo en su tramo de la salida (su posicion es la suma de los tamaños de
+las anteriores), y las que no caben en M se vuelven a particionar hacia su tramo; si
+no, cada particion se ordena en su archivo y al final se concatenan, lo que copia N
+elementos una vez mas por nivel. los elementos iguales a un pivote van a su cubeta
+de igualdad, que se escribe despues de la particion que lo precede sin ordenarse ni
+particionarse de nuevo. cada particion recibe su propia semilla para los pivotes,
+derivada de la de su padre
+archivoEntrada: archivo con los datos desordenados (puede ser el mismo que la salida)
+archivoSalida: archivo donde va el resultado
+inicioSalida: posicion de la salida donde va el primer elemento (0 sin colocacion directa)
+crearSalida: 1 si hay que crear (o vaciar) la salida despues de particionar
+numElementos: cantidad de elementos
+aridadPedida: aridad con que se llamo al ordenamiento
+semilla: semilla de los pivotes de esta particion
+nivel: profundidad de esta particion (1 la de todo el archivo)
+cfg: tamaño de bloque, memoria, backend y motor
+balance: aqui se acumulan la aridad del primer nivel, los niveles y el peor desbalance
+return: 0 si exito, -1 si error
+*/
+static int ordenarPorParticiones(const char *archivoEntrada, const char *archivoSalida,
+                                 size_t inicioSalida, int crearSalida, size_t numElementos,
+                                 int aridadPedida, uint64_t semilla, int nivel,
+                                 const ConfigOrden *cfg, EstadisticasQuick *balance) {
+    int aridad = aridadDeNivel(numElementos, aridadPedida, cfg);
+    if (nivel == 1) {
+        balance->aridadUsada = aridad;
+    }
+    printf("Particionando archivo con %d pivotes (aridad %d)\n", aridad - 1, aridad);
     
-    contadorACero();
-    clock_t inicio = clock();
+    //a-1 pivotes
+    int numPivotes = aridad - 1;
+    int64_t *pivotes = malloc(numPivotes * sizeof(int64_t));
+    if (!pivotes) {
+        return -1;
+    }
     
-    //verificar si archivo cabe en memoria
-    size_t elementosEnMemoria = MEMORY_LIMIT / ELEMENT_SIZE;
+    if (seleccionarPivotes(archivoEntrada, numElementos, numPivotes, pivotes, semilla, cfg) != 0) {
+        free(pivotes);
+        return -1;
+    }
     
-    if (numElementos <= elementosEnMemoria) {
-        //caso base: archivo cabe en memoria, usar quicksort clasico
-        printf("Archivo cabe en memoria, usando quicksort clasico\n");
-        
-        //cargar archivo completo en memoria
-        int64_t *arreglo = malloc(numElementos * sizeof(int64_t));
-        if (!arreglo) {
-            printf("Error: no se pudo allocar memoria para ordenar\n");
-            return -1;
-        }
-        
-        //leer archivo a memoria
-        ArchivoBin archivo;
-        if (abrirArchivo(&archivo, archivoEntrada, "rb") != 0) {
-            free(arreglo);
-            return -1;
-        }
-        
-        for (size_t i = 0; i < numElementos; i++) {
-            if (leerElemento(&archivo, i, &arreglo[i]) != 0) {
-                free(arreglo);
-                cerrarArchivo(&archivo);
-                return -1;
+    //nombres para subarchivos
+    char **nombresSubarchivos = malloc(aridad * sizeof(char*));
+    size_t *tamañosSubarchivos = malloc(aridad * sizeof(size_t));
+    
+    for (int i = 0; i < aridad; i++) {
+        nombresSubarchivos[i] = malloc(256);
+        nombreTemporal(nombresSubarchivos[i], 256, "quick");
+    }
+    
+    //particionar archivo pivotes; los iguales a cada pivote solo se cuentan
+    size_t *iguales = malloc(numPivotes * sizeof(size_t));
+    int resultado = iguales ? particionarArchivo(archivoEntrada, numElementos, pivotes, numPivotes,
+                                                 nombresSubarchivos, tamañosSubarchivos, iguales, cfg) : -1;
+    
+    //balance: la particion mas grande contra el ideal n/a, y cuantas ya caben en M
+    size_t elementosEnMemoria = elementosEnMemoriaConfig(cfg);
+    if (resultado == 0) {
+        size_t mayor = 0;
+        int caben = 0;
+        for (int i = 0; i < aridad; i++) {
+            if (tamañosSubarchivos[i] > mayor) {
+                mayor = tamañosSubarchivos[i];
             }
+            caben += tamañosSubarchivos[i] <= elementosEnMemoria;
         }
-        cerrarArchivo(&archivo);
-        
-        //ordenar en memoria
-        printf("  Ordenando %zu elementos en memoria\n", numElementos);
-        quicksortClasico(arreglo, numElementos);
-        
-        //escribir resultado al archivo de salida
-        if (abrirArchivo(&archivo, archivoSalida, "wb") != 0) {
-            free(arreglo);
-            return -1;
-        }
-        
-        for (size_t i = 0; i < numElementos; i++) {
-            if (escribirElemento(&archivo, i, arreglo[i]) != 0) {
-                free(arreglo);
-                cerrarArchivo(&archivo);
-                return -1;
-            }
+        size_t totalIguales = 0;
+        for (int i = 0; i < numPivotes; i++) {
+            totalIguales += iguales[i];
         }
-        
-        cerrarArchivo(&archivo);
-        free(arreglo);
-    } else {
-        //caso recursivo
-        printf("Particionando archivo con %d pivotes (aridad %d)\n", aridad - 1, aridad);
-        
-        //a-1 pivotes
-        int numPivotes = aridad - 1;
-        int64_t *pivotes = malloc(numPivotes * sizeof(int64_t));
-        if (!pivotes) {
-            return -1;
+        double desbalance = (double)mayor * aridad / (double)numElementos;
+        printf("  Balance: la particion mas grande tiene %zu elementos (%.2f veces n/a), %d de %d caben en M, "
+               "%zu iguales a un pivote\n", mayor, desbalance, caben, aridad, totalIguales);
+        if (desbalance > balance->desbalanceMaximo) {
+            balance->desbalanceMaximo = desbalance;
         }
-        
-        if (seleccionarPivotes(archivoEntrada, numElementos, numPivotes, pivotes) != 0) {
-            free(pivotes);
-            return -1;
+        if (nivel > balance->nivelesParticion) {
+            balance->nivelesParticion = nivel;
         }
-        
-        //nombres para subarchivos
-        char **nombresSubarchivos = malloc(aridad * sizeof(char*));
-        size_t *tamañosSubarchivos = malloc(aridad * sizeof(size_t));
-        
-        for (int i = 0; i < aridad; i++) {
-            nombresSubarchivos[i] = malloc(256);
-            snprintf(nombresSubarchivos[i], 256, "temp_quick_%d.bin", i);
+    }
+    
+    //la entrada ya esta en las particiones, asi que la salida se puede vaciar aunque
+    //sea el mismo archivo
+    if (resultado == 0 && crearSalida && cfg->colocacionDirecta) {
+        OpcionesArchivo opciones = opcionesDeConfig(cfg);
+        ArchivoBin salida;
+        if (abrirArchivoCon(&salida, archivoSalida, "wb", &opciones) != 0) {
+            resultado = -1;
+        } else {
+            cerrarArchivo(&salida);
         }
-        
-        //particionar archivo pivotes
-        if (particionarArchivo(archivoEntrada, numElementos, pivotes, numPivotes,
-                              nombresSubarchivos, tamañosSubarchivos) != 0) {
-            //limpiar memoria
-            for (int i = 0; i < aridad; i++) {
-                free(nombresSubarchivos[i]);
+    }
+    
+    //ordenar cada subarchivo recursivamente
+    size_t posicion = inicioSalida;
+    for (int i = 0; i < aridad && resultado == 0; i++) {
+        if (tamañosSubarchivos[i] > 0) {
+            printf("Ordenando subarchivo %d (%zu elementos)\n", i, tamañosSubarchivos[i]);
+            
+            uint64_t semillaHijo = semilla + (uint64_t)(i + 1) * 0x9E3779B97F4A7C15ULL;
+            if (!cfg->colocacionDirecta) {
+                //en lugar, para concatenar despues
+                if (tamañosSubarchivos[i] <= elementosEnMemoria) {
+                    resultado = ordenarHojaEnArchivo(nombresSubarchivos[i], nombresSubarchivos[i],
+                                                     tamañosSubarchivos[i], cfg);
+                } else {
+                    resultado = ordenarPorParticiones(nombresSubarchivos[i], nombresSubarchivos[i], 0, 1,
+                                                      tamañosSubarchivos[i], aridadPedida, semillaHijo,
+                                                      nivel + 1, cfg, balance);
+                }
+            } else if (tamañosSubarchivos[i] <= elementosEnMemoria) {
+                resultado = ordenarHojaEnSalida(nombresSubarchivos[i], archivoSalida, posicion,
+                                                tamañosSubarchivos[i], cfg);
+            } else {
+                resultado = ordenarPorParticiones(nombresSubarchivos[i], archivoSalida, posicion, 0,
+                                                  tamañosSubarchivos[i], aridadPedida, semillaHijo,
+                                                  nivel + 1, cfg, balance);
             }
-            free(nombresSubarchivos);
-            free(tamañosSubarchivos);
-            free(pivotes);
-            return -1;
+            posicion += tamañosSubarchivos[i];
         }
-        
-        free(pivotes);
-        
-        //ordenar cada subarchivo recursivamente
-        for (int i = 0; i < aridad; i++) {
-            if (tamañosSubarchivos[i] > 0) {
-                printf("Ordenando subarchivo %d (%zu elementos)\n", i, tamañosSubarchivos[i]);
-                
-                //llamada recursiva
-                EstadisticasQuick statsTemp;
-                if (quicksortExterno(nombresSubarchivos[i], nombresSubarchivos[i], 
-                                    tamañosSubarchivos[i], aridad, &statsTemp) != 0) {
-                    for (int j = 0; j < aridad; j++) {
-                        free(nombresSubarchivos[j]);
-                    }
-                    free(nombresSubarchivos);
-                    free(tamañosSubarchivos);
-                    return -1;
-                }
+        //con colocacion directa la particion ya esta en la salida
+        if (cfg->colocacionDirecta) {
+            remove(nombresSubarchivos[i]);
+            //y despues de ella va su cubeta de igualdad
+            if (resultado == 0 && i < numPivotes && iguales[i] > 0) {
+                resultado = escribirIguales(archivoSalida, posicion, pivotes[i], iguales[i], cfg);
+                posicion += iguales[i];
             }
         }
-        
-        //concatenar subarchivos ordenados
+    }
+    
+    //concatenar subarchivos ordenados
+    if (resultado == 0 && !cfg->colocacionDirecta) {
         printf("Concatenando %d subarchivos\n", aridad);
-        if (concatenarSubarchivos(nombresSubarchivos, aridad, archivoSalida) != 0) {
-            //limpiar memoria
-            for (int i = 0; i < aridad; i++) {
-                free(nombresSubarchivos[i]);
-            }
-            free(nombresSubarchivos);
-            free(tamañosSubarchivos);
+        resultado = concatenarSubarchivos(nombresSubarchivos, aridad, pivotes, iguales,
+                                          archivoSalida, cfg);
+    }
+    
+    //eliminar archivos temporales
+    for (int i = 0; i < aridad; i++) {
+        remove(nombresSubarchivos[i]);
+        free(nombresSubarchivos[i]);
+    }
+    free(nombresSubarchivos);
+    free(tamañosSubarchivos);
+    free(iguales);
+    free(pivotes);
+    return resultado;
+}
+
+/*
+implementa quicksort externo principal con un B y un M dados
+archivoEntrada: archivo binario con datos desordenados
+archivoSalida: archivo binario donde guardar resultado ordenado
+numElementos: cantidad de elementos en el archivo
+aridad: numero de subarchivos (cantidad de pivotes + 1)
+cfg: tamaño de bloque, memoria y backend
+stats: estructura para guardar estadisticas
+return: 0 si exito, -1 si error
+*/
+int quicksortExternoCon(const char *archivoEntrada, const char *archivoSalida,
+                        size_t numElementos, int aridad, const ConfigOrden *cfg,
+                        EstadisticasQuick *stats) {
+    
+    if (prepararConfig(cfg) != 0) {
+        return -1;
+    }
+
+    //los accesos se cuentan en el contexto de quien llama (las llamadas recursivas
+    //suman en el del nivel de arriba), o en uno propio si no se dio ninguno
+    ConfigOrden cfgPropia;
+    EstadisticasIO ioPropio;
+    cfg = configConEstadisticas(cfg, &cfgPropia, &ioPropio);
+    EstadisticasIO ioInicio;
+    copiarEstadisticas(cfg->estadisticas, &ioInicio);
+    struct timespec inicio;
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    
+    //verificar si archivo cabe en memoria (descontando lo que usa el pool)
+    size_t elementosEnMemoria = elementosEnMemoriaConfig(cfg);
+    EstadisticasQuick balance = {0};
+    balance.aridadUsada = aridad;
+    
+    if (numElementos <= elementosEnMemoria) {
+        //caso base: archivo cabe en memoria, usar quicksort clasico (o radix sort)
+        printf("Archivo cabe en memoria, usando quicksort clasico\n");
+        
+        if (ordenarHojaEnArchivo(archivoEntrada, archivoSalida, numElementos, cfg) != 0) {
             return -1;
         }
-        
-        //eliminar archivos temporales
-        for (int i = 0; i < aridad; i++) {
-            remove(nombresSubarchivos[i]);
-            free(nombresSubarchivos[i]);
+    } else {
+        //caso recursivo: cada nivel elige su aridad segun lo que queda por ordenar
+        if (ordenarPorParticiones(archivoEntrada, archivoSalida, 0, 1, numElementos,
+                                  aridad, SEMILLA_PIVOTES, 1, cfg, &balance) != 0) {
+            return -1;
         }
-        free(nombresSubarchivos);
-        free(tamañosSubarchivos);
+        printf("Quicksort externo: %d niveles de particion, la particion mas grande midio %.2f veces n/a\n",
+               balance.nivelesParticion, balance.desbalanceMaximo);
     }
     
     //guardar estadisticas
     if (stats) {
-        stats->accesosdisco = obtenerAccesos();
-        stats->tiempoEjecucion = ((double)(clock() - inicio)) / CLOCKS_PER_SEC;
-        stats->aridadUsada = aridad;
+        EstadisticasIO ioFin;
+        copiarEstadisticas(cfg->estadisticas, &ioFin);
+        restarEstadisticas(&ioFin, &ioInicio, &stats->io);
+        stats->accesosdisco = accesosTotales(&stats->io);
+        stats->tiempoEjecucion = segundosRealesDesde(&inicio);
+        stats->aridadUsada = balance.aridadUsada;
+        stats->nivelesParticion = balance.nivelesParticion;
+        stats->desbalanceMaximo = balance.desbalanceMaximo;
     }
     
     return 0;
@@ -173,77 +398,188 @@ int quicksortExternoRecursivo(const char *archivoEntrada, size_t numElementos,
 }
 
 /*
-selecciona a-1 pivotes aleatorios de un bloque del archivo
+aridad mas grande con que se puede particionar: los a-1 pivotes caben en un bloque y
+cada particion necesita al menos un bloque de buffer en cada uno de sus 2 buffers
+cfg: configuracion del ordenamiento
+return: aridad maxima (al menos 2)
+*/
+int aridadMaximaQuick(const ConfigOrden *cfg) {
+    size_t aridad = elementosPorBloqueConfig(cfg);
+    size_t porMemoria = bloquesEnMemoriaConfig(cfg) / 2;
+    if (porMemoria < aridad) {
+        aridad = porMemoria;
+    }
+    return (aridad < 2) ? 2 : (int)aridad;
+}
+
+/*
+fraccion esperada de los elementos que quedan en particiones de mas de x n elementos
+cuando se parte en 'aridad' con pivotes equiespaciados en una muestra de s claves por
+particion: cada particion mide n/(s a) veces una gamma(s), y la fraccion de elementos
+en las que pasan de x n es P(gamma(s+1) > s a x) = e^-y sum_{k<=s} y^k / k!, y = s a x
+(con s = 1, pivotes sueltos al azar, da (1-x)^(a-1) (a x + 1 - x) para n grande)
+*/
+static double desbordeEsperado(int aridad, double x) {
+    double y = (double)SOBREMUESTREO_QUICK * aridad * x;
+    double suma = 0;
+    for (int k = 0; k <= SOBREMUESTREO_QUICK; k++) {
+        suma += exp(-y + k * log(y) - lgamma(k + 1.0));
+    }
+    return suma;
+}
+
+/*
+aridad de un nivel de particion: la fraccion de elementos que queda en particiones
+mas grandes que M (x = M / n) sale de desbordeEsperado. si alguna aridad hasta
+aridadMaximaQuick la deja bajo DESBORDE_QUICK, el nivel es el ultimo y se usa la
+menor (poco mas de n / M, con los buffers mas grandes); si no, la maxima, para que
+los niveles siguientes tengan lo menos posible. con el sobremuestreo de
+seleccionarPivotes 60M con M de ~6M se parte en un solo nivel de ~15 particiones.
+con cfg->aridadPorNivel en 0 siempre es la aridad pedida
+numElementos: n del nivel
+aridadPedida: aridad con que se llamo al ordenamiento
+cfg: configuracion del ordenamiento
+return: aridad del nivel
+*/
+int aridadDeNivel(size_t numElementos, int aridadPedida, const ConfigOrden *cfg) {
+    if (!cfg->aridadPorNivel) {
+        return aridadPedida;
+    }
+    int maxima = aridadMaximaQuick(cfg);
+    double x = (double)elementosEnMemoriaConfig(cfg) / (double)numElementos;
+    if (x >= 1) {
+        return maxima;
+    }
+    for (int aridad = 2; aridad < maxima; aridad++) {
+        if (desbordeEsperado(aridad, x) <= DESBORDE_QUICK) {
+            return aridad;
+        }
+    }
+    return maxima;
+}
+
+//generador propio (xorshift64*) para los pivotes, asi cada llamada tiene su semilla
+//y no depende de rand() ni de la hora
+static uint64_t aleatorioPivotes(uint64_t *estado) {
+    *estado ^= *estado >> 12;
+    *estado ^= *estado << 25;
+    *estado ^= *estado >> 27;
+    return *estado * 2685821657736338717ULL;
+}
+
+//compara dos indices de bloque para qsort
+static int compararIndices(const void *a, const void *b) {
+    size_t x = *(const size_t*)a;
+    size_t y = *(const size_t*)b;
+    return (x > y) - (x < y);
+}
+
+/*
+bloques que lee seleccionarPivotes: SOBREMUESTREO_QUICK claves por particion, de a
+CLAVES_POR_BLOQUE_MUESTRA por bloque (sin pasar de los bloques del archivo)
+numElementos: cantidad total de elementos
+numPivotes: cantidad de pivotes (a-1)
+cfg: tamaño de bloque
+return: bloques de la muestra
+*/
+size_t bloquesMuestraPivotes(size_t numElementos, int numPivotes, const ConfigOrden *cfg) {
+    size_t b = elementosPorBloqueConfig(cfg);
+    size_t totalBloques = (numElementos + b - 1) / b;
+    size_t muestras = (size_t)SOBREMUESTREO_QUICK * (numPivotes + 1);
+    size_t bloques = (muestras + CLAVES_POR_BLOQUE_MUESTRA - 1) / CLAVES_POR_BLOQUE_MUESTRA;
+    return (bloques < totalBloques) ? bloques : totalBloques;
+}
+
+/*
+selecciona a-1 pivotes con sobremuestreo: toma SOBREMUESTREO_QUICK * a claves al azar
+de bloques al azar de todo el archivo, las ordena y usa como pivotes las de rango
+SOBREMUESTREO_QUICK, 2 SOBREMUESTREO_QUICK, ... asi cada particion queda con cerca
+de n / a elementos (ver aridadDeNivel) en vez de depender de un solo bloque. la
+semilla es de cada llamada: la misma entrada y semilla dan los mismos pivotes
 archivo: archivo de donde seleccionar pivotes
 numElementos: cantidad total de elementos
 numPivotes: cantidad de pivotes a seleccionar (a-1)
 pivotes: array donde guardar los pivotes seleccionados
+semilla: semilla de esta llamada
+cfg: tamaño de bloque, memoria y backend
 return: 0 si exito, -1 si error
 */
 int seleccionarPivotes(const char *archivo, size_t numElementos, 
-                       int numPivotes, int64_t *pivotes) {
+                       int numPivotes, int64_t *pivotes, uint64_t semilla,
+                       const ConfigOrden *cfg) {
     
-    //leer un bloque aleatorio
+    OpcionesArchivo opciones = opcionesDeConfig(cfg);
+    size_t b = elementosPorBloqueConfig(cfg);
     ArchivoBin arch;
-    if (abrirArchivo(&arch, archivo, "rb") != 0) {
-        return -1;
-    }
-    
-    //calcular numero de bloques disponibles
-    size_t totalBloques = (numElementos + ELEMENTS_PER_BLOCK - 1) / ELEMENTS_PER_BLOCK;
-    
-    //seleccionar bloque aleatorio
-    srand(time(NULL));
-    size_t bloqueAleatorio = rand() % totalBloques;
-    
-    //cargar el bloque aleatorio
-    if (cargarEnMemoria(&arch, bloqueAleatorio) != 0) {
-        cerrarArchivo(&arch);
+    if (abrirArchivoCon(&arch, archivo, "rb", &opciones) != 0) {
         return -1;
     }
     
-    //calcular cuantos elementos tiene este bloque
-    size_t elementosEnBloque = ELEMENTS_PER_BLOCK;
-    if (bloqueAleatorio == totalBloques - 1) {
-        //ultimo bloque puede tener menos elementos
-        elementosEnBloque = numElementos - (bloqueAleatorio * ELEMENTS_PER_BLOCK);
+    //el estado no puede ser 0; se mezcla la semilla para que semillas vecinas
+    //(las de particiones hermanas) den secuencias distintas
+    uint64_t estado = (semilla ^ 0x9E3779B97F4A7C15ULL) * 0xBF58476D1CE4E5B9ULL;
+    estado ^= estado >> 31;
+    if (estado == 0) {
+        estado = 1;
     }
     
-    //seleccionar numPivotes elementos aleatorios del bloque
-    int64_t *elementosBloque = malloc(elementosEnBloque * sizeof(int64_t));
-    if (!elementosBloque) {
+    //bloques de la muestra, leidos en orden y sin repetir
+    size_t totalBloques = (numElementos + b - 1) / b;
+    size_t numBloques = bloquesMuestraPivotes(numElementos, numPivotes, cfg);
+    size_t numMuestras = (size_t)SOBREMUESTREO_QUICK * (numPivotes + 1);
+    size_t *bloques = malloc(numBloques * sizeof(size_t));
+    int64_t *muestra = malloc(numMuestras * sizeof(int64_t));
+    int64_t *elementosBloque = malloc(b * sizeof(int64_t));
+    if (!bloques || !muestra || !elementosBloque) {
+        free(bloques);
+        free(muestra);
+        free(elementosBloque);
         cerrarArchivo(&arch);
         return -1;
     }
-    
-    //copiar elementos del buffer al array temporal
-    for (size_t i = 0; i < elementosEnBloque; i++) {
-        elementosBloque[i] = arch.buffer[i];
-    }
-    
-    cerrarArchivo(&arch);
-    
-    //si el bloque tiene menos elementos que pivotes necesarios
-    if (elementosEnBloque < numPivotes) {
-        printf("Error: bloque tiene menos elementos que pivotes necesarios\n");
-        free(elementosBloque);
-        return -1;
+    for (size_t i = 0; i < numBloques; i++) {
+        bloques[i] = (numBloques == totalBloques) ? i : aleatorioPivotes(&estado) % totalBloques;
     }
-    
-    //seleccionar numPivotes elementos aleatorios
-    for (int i = 0; i < numPivotes; i++) {
-        int indiceAleatorio = rand() % elementosEnBloque;
-        pivotes[i] = elementosBloque[indiceAleatorio];
+    qsort(bloques, numBloques, sizeof(size_t), compararIndices);
+    
+    //repartir las claves entre los bloques leidos; se lee por rango (no por bloque
+    //fisico) para que tambien funcione sobre vistas
+    size_t tomadas = 0;
+    size_t leidos = 0;
+    for (size_t i = 0; i < numBloques; i++) {
+        size_t elementosEnBloque = numElementos - bloques[i] * b;
+        if (elementosEnBloque > b) {
+            elementosEnBloque = b;
+        }
+        //un bloque repetido ya esta cargado
+        if (i == 0 || bloques[i] != bloques[i - 1]) {
+            if (leerRango(&arch, bloques[i] * b, elementosEnBloque, elementosBloque) != 0) {
+                free(bloques);
+                free(muestra);
+                free(elementosBloque);
+                cerrarArchivo(&arch);
+                return -1;
+            }
+            leidos++;
+        }
         
-        //evitar duplicados removiendo el elemento seleccionado
-        elementosBloque[indiceAleatorio] = elementosBloque[elementosEnBloque - 1];
-        elementosEnBloque--;
+        //a este bloque le tocan las claves hasta su parte proporcional de la muestra
+        size_t hasta = numMuestras * (i + 1) / numBloques;
+        for (; tomadas < hasta; tomadas++) {
+            muestra[tomadas] = elementosBloque[aleatorioPivotes(&estado) % elementosEnBloque];
+        }
     }
-    
+    cerrarArchivo(&arch);
+    free(bloques);
     free(elementosBloque);
     
-    //ordenar los pivotes para facilitar la particion
-    qsort(pivotes, numPivotes, sizeof(int64_t), compararInt64);
+    //pivotes equiespaciados en la muestra ordenada
+    qsort(muestra, numMuestras, sizeof(int64_t), compararInt64);
+    for (int i = 0; i < numPivotes; i++) {
+        pivotes[i] = muestra[(size_t)(i + 1) * numMuestras / (numPivotes + 1)];
+    }
+    free(muestra);
+    printf("  Muestra de %zu claves de %zu bloques\n", numMuestras, leidos);
     
     printf("  Pivotes seleccionados: ");
     for (int i = 0; i < numPivotes; i++) {
@@ -255,69 +591,122 @@ int seleccionarPivotes(const char *archivo, size_t numElementos,
 }
 
 /*
-particiona el archivo en a subarchivos usando a-1 pivotes
+particiona el archivo en a subarchivos usando a-1 pivotes. el subarchivo j recibe
+los elementos entre pivotes[j-1] y pivotes[j] (sin incluirlos); los iguales a un
+pivote no se escriben, solo se cuentan en su cubeta de igualdad, que ya esta ordenada
+y no se vuelve a particionar. asi con muchas claves repetidas (o todas iguales) cada
+subarchivo es mas chico que la entrada. con pivotes repetidos los iguales van a la
+cubeta del primero y los subarchivos entre copias quedan vacios
 archivoEntrada: archivo a particionar
 numElementos: cantidad de elementos
 pivotes: array con a-1 pivotes ordenados
 numPivotes: cantidad de pivotes (a-1)
 nombresSubarchivos: array con nombres de a subarchivos
 tamañosSubarchivos: array donde guardar el tamaño de cada subarchivo
+iguales: array donde guardar cuantos elementos son iguales a cada pivote (a-1)
+cfg: tamaño de bloque, memoria y backend
 return: 0 si exito, -1 si error
 */
 int particionarArchivo(const char *archivoEntrada, size_t numElementos,
                        int64_t *pivotes, int numPivotes, 
-                       char **nombresSubarchivos, size_t *tamañosSubarchivos) {
+                       char **nombresSubarchivos, size_t *tamañosSubarchivos,
+                       size_t *iguales, const ConfigOrden *cfg) {
     
     //abrir archivo de entrada
+    OpcionesArchivo opciones = opcionesDeConfig(cfg);
     ArchivoBin entrada;
-    if (abrirArchivo(&entrada, archivoEntrada, "rb") != 0) {
+    if (abrirArchivoCon(&entrada, archivoEntrada, "rb", &opciones) != 0) {
         return -1;
     }
     
     //crear y abrir todos los subarchivos
     int numSubarchivos = numPivotes + 1;
     ArchivoBin *subarchivos = malloc(numSubarchivos * sizeof(ArchivoBin));
+    EscritorSecuencial *escritores = malloc(numSubarchivos * sizeof(EscritorSecuencial));
+
+    //cada particion junta sus bloques en escrituras grandes; la memoria de trabajo
+    //se reparte entre los 2 buffers de cada escritor
+    size_t bloquesPorEscritor = bloquesEnMemoriaConfig(cfg) / (2 * (size_t)numSubarchivos);
+    if (bloquesPorEscritor > bloquesDeTrozo(cfg->tamBloque, ESCRITOR_BLOQUES)) {
+        bloquesPorEscritor = bloquesDeTrozo(cfg->tamBloque, ESCRITOR_BLOQUES);
+    }
     
     for (int i = 0; i < numSubarchivos; i++) {
-        if (abrirArchivo(&subarchivos[i], nombresSubarchivos[i], "wb") != 0) {
+        if (abrirArchivoCon(&subarchivos[i], nombresSubarchivos[i], "wb", &opciones) != 0 ||
+            abrirEscritor(&escritores[i], &subarchivos[i], 0, bloquesPorEscritor) != 0) {
             //limpiar en caso de error
             for (int j = 0; j < i; j++) {
+                cerrarEscritor(&escritores[j]);
                 cerrarArchivo(&subarchivos[j]);
             }
             free(subarchivos);
+            free(escritores);
             cerrarArchivo(&entrada);
             return -1;
         }
         tamañosSubarchivos[i] = 0;
     }
+    for (int i = 0; i < numPivotes; i++) {
+        iguales[i] = 0;
+    }
+
+    //la entrada se lee con lectura anticipada mientras se reparte cada bloque
+    LectorSecuencial lector;
+    if (abrirLector(&lector, &entrada, 0, numElementos, LECTOR_PROFUNDIDAD,
+                    bloquesDeTrozo(cfg->tamBloque, LECTOR_BLOQUES)) != 0) {
+        for (int j = 0; j < numSubarchivos; j++) {
+            cerrarEscritor(&escritores[j]);
+            cerrarArchivo(&subarchivos[j]);
+        }
+        free(subarchivos);
+        free(escritores);
+        cerrarArchivo(&entrada);
+        return -1;
+    }
     
     //leer todos los elementos y particionarlos
     for (size_t i = 0; i < numElementos; i++) {
         int64_t elemento;
-        if (leerElemento(&entrada, i, &elemento) != 0) {
+        if (siguienteElemento(&lector, &elemento) != 1) {
+            cerrarLector(&lector);
             for (int j = 0; j < numSubarchivos; j++) {
+                cerrarEscritor(&escritores[j]);
                 cerrarArchivo(&subarchivos[j]);
             }
             free(subarchivos);
+            free(escritores);
             cerrarArchivo(&entrada);
             return -1;
         }
         
-        //determinar a que subarchivo va el elemento
+        //determinar a que subarchivo va el elemento: el primer pivote >= elemento
+        //(busqueda binaria, con aridades grandes un recorrido lineal domina)
         int subarchivo = 0;
-        for (int j = 0; j < numPivotes; j++) {
-            if (elemento <= pivotes[j]) {
-                break;
+        int hasta = numPivotes;
+        while (subarchivo < hasta) {
+            int mitad = (subarchivo + hasta) / 2;
+            if (pivotes[mitad] < elemento) {
+                subarchivo = mitad + 1;
+            } else {
+                hasta = mitad;
             }
-            subarchivo++;
+        }
+        
+        //igual al pivote: a su cubeta de igualdad, sin escribirlo
+        if (subarchivo < numPivotes && pivotes[subarchivo] == elemento) {
+            iguales[subarchivo]++;
+            continue;
         }
         
         //escribir elemento al subarchivo correspondiente
-        if (escribirElemento(&subarchivos[subarchivo], tamañosSubarchivos[subarchivo], elemento) != 0) {
+        if (agregarElemento(&escritores[subarchivo], elemento) != 0) {
+            cerrarLector(&lector);
             for (int j = 0; j < numSubarchivos; j++) {
+                cerrarEscritor(&escritores[j]);
                 cerrarArchivo(&subarchivos[j]);
             }
             free(subarchivos);
+            free(escritores);
             cerrarArchivo(&entrada);
             return -1;
         }
@@ -326,29 +715,57 @@ int particionarArchivo(const char *archivoEntrada, size_t numElementos,
     }
     
     //cerrar todos los archivos
+    int resultado = 0;
+    cerrarLector(&lector);
     cerrarArchivo(&entrada);
     for (int i = 0; i < numSubarchivos; i++) {
+        if (cerrarEscritor(&escritores[i]) != 0) {
+            resultado = -1;
+        }
         cerrarArchivo(&subarchivos[i]);
         printf("  Subarchivo %d: %zu elementos\n", i, tamañosSubarchivos[i]);
     }
     
     free(subarchivos);
-    return 0;
+    free(escritores);
+    return resultado;
 }
 
 /*
-concatena multiples subarchivos ordenados en un archivo de salida
+concatena multiples subarchivos ordenados en un archivo de salida; despues del
+subarchivo i van las copias de pivotes[i] de su cubeta de igualdad
 nombresSubarchivos: array con nombres de subarchivos
 numArchivos: cantidad de subarchivos
+pivotes: pivotes de la particion (numArchivos - 1)
+iguales: elementos iguales a cada pivote (numArchivos - 1)
 archivoSalida: archivo donde guardar el resultado concatenado
+cfg: tamaño de bloque, memoria y backend
 return: 0 si exito, -1 si error
 */
 int concatenarSubarchivos(char **nombresSubarchivos, int numArchivos,
-                          const char *archivoSalida) {
-    
-    //abrir archivo de salida
+                          const int64_t *pivotes, const size_t *iguales,
+                          const char *archivoSalida, const ConfigOrden *cfg) {
+    
+    //abrir archivo de salida, se escribe en orden con escritura agrupada. los 2 buffers
+    //del escritor, los 2 del lector y el trozo usan cada uno a lo mas 1/FRACCION_COPIA de M
+    OpcionesArchivo opciones = opcionesDeConfig(cfg);
+    size_t bloquesEscritor = bloquesAcotadosConfig(cfg, bloquesDeTrozo(cfg->tamBloque, ESCRITOR_BLOQUES),
+                                                   FRACCION_COPIA);
+    size_t bloquesCopia = bloquesAcotadosConfig(cfg, bloquesDeTrozo(cfg->tamBloque, COPIA_BLOQUES), FRACCION_COPIA);
+    size_t tamTrozo = bloquesCopia * elementosPorBloqueConfig(cfg);
     ArchivoBin salida;
-    if (abrirArchivo(&salida, archivoSalida, "wb") != 0) {
+    if (abrirArchivoCon(&salida, archivoSalida, "wb", &opciones) != 0) {
+        return -1;
+    }
+    EscritorSecuencial escritor;
+    if (abrirEscritor(&escritor, &salida, 0, bloquesEscritor) != 0) {
+        cerrarArchivo(&salida);
+        return -1;
+    }
+    int64_t *trozo = malloc(tamTrozo * sizeof(int64_t));
+    if (!trozo) {
+        cerrarEscritor(&escritor);
+        cerrarArchivo(&salida);
         return -1;
     }
     
@@ -359,33 +776,147 @@ int concatenarSubarchivos(char **nombresSubarchivos, int numArchivos,
         size_t tamañoSubarchivo = obtenerTamañoArchivo(nombresSubarchivos[i]);
         
         if (tamañoSubarchivo > 0) {
-            //abrir subarchivo
+            //abrir subarchivo con lectura anticipada
             ArchivoBin subarchivo;
-            if (abrirArchivo(&subarchivo, nombresSubarchivos[i], "rb") != 0) {
+            LectorSecuencial lector;
+            if (abrirArchivoCon(&subarchivo, nombresSubarchivos[i], "rb", &opciones) != 0) {
+                free(trozo);
+                cerrarEscritor(&escritor);
+                cerrarArchivo(&salida);
+                return -1;
+            }
+            if (abrirLector(&lector, &subarchivo, 0, tamañoSubarchivo, 2, bloquesCopia) != 0) {
+                cerrarArchivo(&subarchivo);
+                free(trozo);
+                cerrarEscritor(&escritor);
                 cerrarArchivo(&salida);
                 return -1;
             }
             
             //copiar todos los elementos del subarchivo
-            for (size_t j = 0; j < tamañoSubarchivo; j++) {
-                int64_t elemento;
-                if (leerElemento(&subarchivo, j, &elemento) != 0 ||
-                    escribirElemento(&salida, posicionSalida, elemento) != 0) {
+            long leidos;
+            while ((leidos = leerSiguientes(&lector, tamTrozo, trozo)) != 0) {
+                if (leidos < 0 || agregarRango(&escritor, trozo, (size_t)leidos) != 0) {
+                    cerrarLector(&lector);
                     cerrarArchivo(&subarchivo);
+                    free(trozo);
+                    cerrarEscritor(&escritor);
                     cerrarArchivo(&salida);
                     return -1;
                 }
-                posicionSalida++;
+                posicionSalida += (size_t)leidos;
             }
             
+            cerrarLector(&lector);
             cerrarArchivo(&subarchivo);
             printf("  Concatenado subarchivo %d: %zu elementos\n", i, tamañoSubarchivo);
         }
+        
+        //cubeta de igualdad del pivote i
+        if (i < numArchivos - 1 && iguales[i] > 0) {
+            size_t quedan = iguales[i];
+            while (quedan > 0) {
+                size_t cantidad = (quedan < tamTrozo) ? quedan : tamTrozo;
+                for (size_t j = 0; j < cantidad; j++) {
+                    trozo[j] = pivotes[i];
+                }
+                if (agregarRango(&escritor, trozo, cantidad) != 0) {
+                    free(trozo);
+                    cerrarEscritor(&escritor);
+                    cerrarArchivo(&salida);
+                    return -1;
+                }
+                quedan -= cantidad;
+            }
+            posicionSalida += iguales[i];
+        }
     }
     
+    free(trozo);
+    int resultado = cerrarEscritor(&escritor);
     cerrarArchivo(&salida);
     printf("  Total concatenado: %zu elementos\n", posicionSalida);
-    return 0;
+    return resultado;
+}
+
+//baja el elemento i del heap de maximos hasta su lugar
+static void hundirMaximo(int64_t *heap, size_t tamaño, size_t i) {
+    int64_t valor = heap[i];
+    while (1) {
+        size_t hijo = 2 * i + 1;
+        if (hijo >= tamaño) {
+            break;
+        }
+        if (hijo + 1 < tamaño && heap[hijo + 1] > heap[hijo]) {
+            hijo++;
+        }
+        if (heap[hijo] <= valor) {
+            break;
+        }
+        heap[i] = heap[hijo];
+        i = hijo;
+    }
+    heap[i] = valor;
+}
+
+//heapsort, para los tramos donde el quicksort se degenera
+static void heapsortTramo(int64_t *arreglo, size_t n) {
+    for (size_t i = n / 2; i > 0; i--) {
+        hundirMaximo(arreglo, n, i - 1);
+    }
+    for (size_t fin = n; fin > 1; fin--) {
+        intercambiar(&arreglo[0], &arreglo[fin - 1]);
+        hundirMaximo(arreglo, fin - 1, 0);
+    }
+}
+
+/*
+introsort: quicksort con pivote mediana de tres y particion de Hoare, recursion solo
+en el lado mas chico, tramos de hasta TRAMO_SIMD con la red de simd.c y heapsort si
+la profundidad pasa de 2 log2(n)
+arreglo: tramo a ordenar
+n: cantidad de elementos
+profundidad: particiones que quedan antes de pasar a heapsort
+*/
+static void quicksortTramo(int64_t *arreglo, size_t n, int profundidad) {
+    while (n > TRAMO_SIMD) {
+        if (profundidad-- == 0) {
+            heapsortTramo(arreglo, n);
+            return;
+        }
+
+        //mediana de tres: deja arreglo[0] <= arreglo[medio] <= arreglo[n-1]
+        size_t medio = n / 2;
+        if (arreglo[medio] < arreglo[0]) intercambiar(&arreglo[medio], &arreglo[0]);
+        if (arreglo[n - 1] < arreglo[medio]) {
+            intercambiar(&arreglo[n - 1], &arreglo[medio]);
+            if (arreglo[medio] < arreglo[0]) intercambiar(&arreglo[medio], &arreglo[0]);
+        }
+        int64_t pivote = arreglo[medio];
+
+        //Hoare: los extremos ya estan del lado correcto y sirven de centinela
+        size_t i = 0, j = n - 1;
+        while (1) {
+            do { i++; } while (arreglo[i] < pivote);
+            do { j--; } while (arreglo[j] > pivote);
+            if (i >= j) {
+                break;
+            }
+            intercambiar(&arreglo[i], &arreglo[j]);
+        }
+
+        //[0, j] <= pivote <= [j+1, n)
+        size_t izquierda = j + 1;
+        if (izquierda < n - izquierda) {
+            quicksortTramo(arreglo, izquierda, profundidad);
+            arreglo += izquierda;
+            n -= izquierda;
+        } else {
+            quicksortTramo(arreglo + izquierda, n - izquierda, profundidad);
+            n = izquierda;
+        }
+    }
+    ordenarTramoCorto(arreglo, n);
 }
 
 /*
@@ -397,8 +928,11 @@ return: 0 si exito, -1 si error
 int quicksortClasico(int64_t *arreglo, size_t n) {
     if (n <= 1) return 0;
     
-    //usar qsort de la biblioteca estandar para simplicidad
-    qsort(arreglo, n, sizeof(int64_t), compararInt64);
+    int profundidad = 0;
+    for (size_t m = n; m > 1; m /= 2) {
+        profundidad += 2;
+    }
+    quicksortTramo(arreglo, n, profundidad);
     
     return 0;
 }
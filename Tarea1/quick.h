@@ -2,32 +2,53 @@
 #define QUICK_H
 
 #include "disco.h"
+#include "config.h"
 #include <stdint.h>
 
+#define DESBORDE_QUICK 0.01  //fraccion esperada de elementos en particiones que no caben en M
+#define SOBREMUESTREO_QUICK 32        //claves de la muestra por cada particion
+#define CLAVES_POR_BLOQUE_MUESTRA 16  //claves que se toman de cada bloque leido para la muestra
+#define SEMILLA_PIVOTES 0x5DEECE66DULL //semilla de los pivotes del primer nivel
+#define FRACCION_COPIA 8  //cada buffer al concatenar o llenar una cubeta usa a lo mas 1/8 de la memoria de trabajo
+
 //estructura para estadisticas de quicksort externo
 typedef struct {
     long long accesosdisco;
-    double tiempoEjecucion;
+    EstadisticasIO io; //detalle de los accesos (lecturas, escrituras, bytes, saltos, descargas)
+    double tiempoEjecucion; //segundos de reloj real (con varios hilos no se suma la CPU de cada uno)
     int aridadUsada;
+    int nivelesParticion;    //niveles de particion de la rama mas profunda (0 si cupo en memoria)
+    double desbalanceMaximo; //peor razon entre la particion mas grande de un nivel y n/a
 } EstadisticasQuick;
 
 //funciones principales quicksort externo
 int quicksortExterno(const char *archivoEntrada, const char *archivoSalida,
                      size_t numElementos, int aridad, EstadisticasQuick *stats);
 
+int quicksortExternoCon(const char *archivoEntrada, const char *archivoSalida,
+                        size_t numElementos, int aridad, const ConfigOrden *cfg,
+                        EstadisticasQuick *stats);
+
 //auxiliares
 int quicksortExternoRecursivo(const char *archivoEntrada, size_t numElementos, 
                               int aridad);
 
+int aridadMaximaQuick(const ConfigOrden *cfg);
+int aridadDeNivel(size_t numElementos, int aridadPedida, const ConfigOrden *cfg);
+
+size_t bloquesMuestraPivotes(size_t numElementos, int numPivotes, const ConfigOrden *cfg);
 int seleccionarPivotes(const char *archivo, size_t numElementos, 
-                       int numPivotes, int64_t *pivotes);
+                       int numPivotes, int64_t *pivotes, uint64_t semilla,
+                       const ConfigOrden *cfg);
 
 int particionarArchivo(const char *archivoEntrada, size_t numElementos,
                        int64_t *pivotes, int numPivotes, 
-                       char **nombresSubarchivos, size_t *tamañosSubarchivos);
+                       char **nombresSubarchivos, size_t *tamañosSubarchivos,
+                       size_t *iguales, const ConfigOrden *cfg);
 
 int concatenarSubarchivos(char **nombresSubarchivos, int numArchivos,
-                          const char *archivoSalida);
+                          const int64_t *pivotes, const size_t *iguales,
+                          const char *archivoSalida, const ConfigOrden *cfg);
 
 //mas auxiliares
 int quicksortClasico(int64_t *arreglo, size_t n);
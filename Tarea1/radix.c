@@ -0,0 +1,120 @@
+#include "radix.h"
+#include "merge.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+//digito 'pasada' de la clave; se invierte el bit de signo para que el orden de
+//los enteros sin signo sea el de los int64_t
+static inline size_t digitoRadix(int64_t clave, int pasada) {
+    uint64_t sinSigno = (uint64_t)clave ^ ((uint64_t)1 << 63);
+    return (size_t)((sinSigno >> (pasada * BITS_RADIX)) & (DIGITOS_RADIX - 1));
+}
+
+/*
+radix sort LSD alternando entre arreglo y aux; los histogramas de todas las pasadas
+se cuentan en un solo recorrido, y se salta la pasada cuyo digito es igual en todos
+los elementos (por ejemplo los bits altos de claves chicas). los histogramas
+(MEMORIA_RADIX bytes) se reservan aparte del auxiliar
+arreglo: arreglo a ordenar
+aux: arreglo auxiliar de al menos n elementos
+n: cantidad de elementos
+return: 0 si exito, -1 si error
+*/
+static int radixLSD(int64_t *arreglo, int64_t *aux, size_t n) {
+    size_t *histogramas = calloc((size_t)PASADAS_RADIX * DIGITOS_RADIX, sizeof(size_t));
+    if (!histogramas) {
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (int p = 0; p < PASADAS_RADIX; p++) {
+            histogramas[p * DIGITOS_RADIX + digitoRadix(arreglo[i], p)]++;
+        }
+    }
+
+    int64_t *origen = arreglo;
+    int64_t *destino = aux;
+    for (int p = 0; p < PASADAS_RADIX; p++) {
+        size_t *conteo = histogramas + p * DIGITOS_RADIX;
+
+        //pasada degenerada: todos caen en el mismo digito y el orden no cambia
+        if (conteo[digitoRadix(origen[0], p)] == n) {
+            continue;
+        }
+
+        //posicion inicial de cada digito en destino
+        size_t suma = 0;
+        for (size_t d = 0; d < DIGITOS_RADIX; d++) {
+            size_t cantidad = conteo[d];
+            conteo[d] = suma;
+            suma += cantidad;
+        }
+        for (size_t i = 0; i < n; i++) {
+            int64_t clave = origen[i];
+            destino[conteo[digitoRadix(clave, p)]++] = clave;
+        }
+
+        int64_t *temp = origen;
+        origen = destino;
+        destino = temp;
+    }
+
+    //con una cantidad impar de pasadas hechas el resultado quedo en aux
+    if (origen != arreglo) {
+        memcpy(arreglo, origen, n * sizeof(int64_t));
+    }
+    free(histogramas);
+    return 0;
+}
+
+/*
+ordena un arreglo con radix sort reservando su auxiliar (n, n/2 o nada si no hay memoria)
+arreglo: arreglo a ordenar
+n: cantidad de elementos
+return: 0 si exito, -1 si error
+*/
+int radixSort(int64_t *arreglo, size_t n) {
+    size_t tamAux = n;
+    int64_t *aux = malloc(tamAux * sizeof(int64_t));
+    if (!aux) {
+        tamAux = (n + 1) / 2;
+        aux = malloc(tamAux * sizeof(int64_t));
+        if (!aux) {
+            tamAux = 0;
+        }
+    }
+    int resultado = radixSortCon(arreglo, n, aux, tamAux);
+    free(aux);
+    return resultado;
+}
+
+/*
+radix sort sin reservar el auxiliar: con tamAux >= n es un radix sort LSD directo;
+con menos se ordenan las mitades por separado y se mezclan con lo que quepa en aux,
+asi el caso base no se pasa de M
+arreglo: arreglo a ordenar
+n: cantidad de elementos
+aux: arreglo auxiliar, puede ser NULL si tamAux es 0
+tamAux: elementos disponibles en aux
+return: 0 si exito, -1 si error
+*/
+int radixSortCon(int64_t *arreglo, size_t n, int64_t *aux, size_t tamAux) {
+    //con pocos elementos los histogramas cuestan mas que comparar
+    if (n < RADIX_MINIMO || tamAux < RADIX_MINIMO / 2) {
+        return mergesortClasicoCon(arreglo, n, aux, tamAux);
+    }
+    if (tamAux >= n) {
+        if (radixLSD(arreglo, aux, n) != 0) {
+            return mergesortClasicoCon(arreglo, n, aux, tamAux);
+        }
+        return 0;
+    }
+
+    size_t medio = n / 2;
+    if (radixSortCon(arreglo, medio, aux, tamAux) != 0 ||
+        radixSortCon(arreglo + medio, n - medio, aux, tamAux) != 0) {
+        return -1;
+    }
+    mezclarConBuffer(arreglo, medio, n, aux, tamAux);
+    return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef RADIX_H
+#define RADIX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BITS_RADIX 11  //bits por digito del radix sort (6 pasadas para 64 bits)
+#define RADIX_MINIMO 256  //con menos elementos se usa el mergesort en memoria
+#define DIGITOS_RADIX (1 << BITS_RADIX)
+#define PASADAS_RADIX ((64 + BITS_RADIX - 1) / BITS_RADIX)
+#define MEMORIA_RADIX ((size_t)PASADAS_RADIX * DIGITOS_RADIX * sizeof(size_t))  //histogramas de un radix sort (96KB)
+
+//radix sort LSD en memoria para claves int64_t
+int radixSort(int64_t *arreglo, size_t n);
+int radixSortCon(int64_t *arreglo, size_t n, int64_t *aux, size_t tamAux);
+
+#endif
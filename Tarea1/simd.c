@@ -0,0 +1,304 @@
+#include "simd.h"
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAY_AVX2 1
+#else
+#define HAY_AVX2 0
+#endif
+
+//kernels en uso (AVX2 o escalares)
+static void (*ordenarTramosActual)(int64_t *, size_t);
+static void (*ordenarTramoCortoActual)(int64_t *, size_t);
+static void (*mezclarOrdenadosActual)(const int64_t *, size_t, const int64_t *, size_t, int64_t *);
+static int simdActivo = 0;
+static int forzarEscalares = 0;
+static pthread_once_t kernelsElegidos = PTHREAD_ONCE_INIT;
+
+//-------------------- kernels escalares --------------------
+
+//ordena por insercion un tramo corto
+static void ordenarTramoCortoEscalar(int64_t *arreglo, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        int64_t valor = arreglo[i];
+        size_t j = i;
+        while (j > 0 && arreglo[j - 1] > valor) {
+            arreglo[j] = arreglo[j - 1];
+            j--;
+        }
+        arreglo[j] = valor;
+    }
+}
+
+static void ordenarTramosEscalar(int64_t *arreglo, size_t n) {
+    for (size_t i = 0; i < n; i += TRAMO_SIMD) {
+        ordenarTramoCortoEscalar(arreglo + i, (n - i < TRAMO_SIMD) ? n - i : TRAMO_SIMD);
+    }
+}
+
+//mezcla sin saltos condicionales en el ciclo principal: el compilador deja la
+//eleccion como cmov, asi las claves aleatorias no fallan la prediccion
+static void mezclarOrdenadosEscalar(const int64_t *a, size_t na, const int64_t *b, size_t nb,
+                                    int64_t *destino) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        int64_t x = a[i];
+        int64_t y = b[j];
+        int tomaB = y < x;
+        destino[k++] = tomaB ? y : x;
+        j += tomaB;
+        i += !tomaB;
+    }
+    //destino puede terminar justo donde empieza b, asi que se mueve con memmove
+    memmove(destino + k, a + i, (na - i) * sizeof(int64_t));
+    k += na - i;
+    memmove(destino + k, b + j, (nb - j) * sizeof(int64_t));
+}
+
+//-------------------- kernels AVX2 --------------------
+
+#if HAY_AVX2
+
+#define AVX2 __attribute__((target("avx2")))
+
+//deja en *a el minimo y en *b el maximo de cada carril
+static inline AVX2 void minimoMaximo(__m256i *a, __m256i *b) {
+    __m256i mayor = _mm256_cmpgt_epi64(*a, *b);
+    __m256i minimo = _mm256_blendv_epi8(*a, *b, mayor);
+    __m256i maximo = _mm256_blendv_epi8(*b, *a, mayor);
+    *a = minimo;
+    *b = maximo;
+}
+
+//ordena una secuencia bitonica de 4 elementos de un registro
+static inline AVX2 __m256i limpiarBitonico(__m256i v) {
+    //distancia 2: carriles (0,2) y (1,3)
+    __m256i otro = _mm256_permute4x64_epi64(v, 0x4E);
+    __m256i mayor = _mm256_cmpgt_epi64(v, otro);
+    __m256i minimo = _mm256_blendv_epi8(v, otro, mayor);
+    __m256i maximo = _mm256_blendv_epi8(otro, v, mayor);
+    v = _mm256_blend_epi32(minimo, maximo, 0xF0);
+    //distancia 1: carriles (0,1) y (2,3)
+    otro = _mm256_permute4x64_epi64(v, 0xB1);
+    mayor = _mm256_cmpgt_epi64(v, otro);
+    minimo = _mm256_blendv_epi8(v, otro, mayor);
+    maximo = _mm256_blendv_epi8(otro, v, mayor);
+    return _mm256_blend_epi32(minimo, maximo, 0xCC);
+}
+
+//mezcla bitonica de dos registros ordenados: *a queda con los 4 menores y *b con
+//los 4 mayores, ambos ordenados
+static inline AVX2 void mezclar4x4(__m256i *a, __m256i *b) {
+    *b = _mm256_permute4x64_epi64(*b, 0x1B);
+    minimoMaximo(a, b);
+    *a = limpiarBitonico(*a);
+    *b = limpiarBitonico(*b);
+}
+
+//ordena 16 elementos con una red de ordenamiento en registros
+static AVX2 void ordenar16Avx2(int64_t *arreglo) {
+    __m256i r0 = _mm256_loadu_si256((const __m256i *)(arreglo + 0));
+    __m256i r1 = _mm256_loadu_si256((const __m256i *)(arreglo + 4));
+    __m256i r2 = _mm256_loadu_si256((const __m256i *)(arreglo + 8));
+    __m256i r3 = _mm256_loadu_si256((const __m256i *)(arreglo + 12));
+
+    //red de 4 entradas entre registros: cada carril queda como columna ordenada
+    minimoMaximo(&r0, &r1);
+    minimoMaximo(&r2, &r3);
+    minimoMaximo(&r0, &r2);
+    minimoMaximo(&r1, &r3);
+    minimoMaximo(&r1, &r2);
+
+    //transponer para que cada registro sea una fila ordenada de 4
+    __m256i t0 = _mm256_unpacklo_epi64(r0, r1);
+    __m256i t1 = _mm256_unpackhi_epi64(r0, r1);
+    __m256i t2 = _mm256_unpacklo_epi64(r2, r3);
+    __m256i t3 = _mm256_unpackhi_epi64(r2, r3);
+    r0 = _mm256_permute2x128_si256(t0, t2, 0x20);
+    r1 = _mm256_permute2x128_si256(t1, t3, 0x20);
+    r2 = _mm256_permute2x128_si256(t0, t2, 0x31);
+    r3 = _mm256_permute2x128_si256(t1, t3, 0x31);
+
+    //filas de 4 -> secuencias de 8
+    mezclar4x4(&r0, &r1);
+    mezclar4x4(&r2, &r3);
+
+    //secuencias de 8 -> 16: la segunda se invierte para formar una bitonica
+    t2 = _mm256_permute4x64_epi64(r3, 0x1B);
+    t3 = _mm256_permute4x64_epi64(r2, 0x1B);
+    minimoMaximo(&r0, &t2);
+    minimoMaximo(&r1, &t3);
+    minimoMaximo(&r0, &r1);
+    minimoMaximo(&t2, &t3);
+    r0 = limpiarBitonico(r0);
+    r1 = limpiarBitonico(r1);
+    t2 = limpiarBitonico(t2);
+    t3 = limpiarBitonico(t3);
+
+    _mm256_storeu_si256((__m256i *)(arreglo + 0), r0);
+    _mm256_storeu_si256((__m256i *)(arreglo + 4), r1);
+    _mm256_storeu_si256((__m256i *)(arreglo + 8), t2);
+    _mm256_storeu_si256((__m256i *)(arreglo + 12), t3);
+}
+
+//tramos de menos de 16 se completan con INT64_MAX, que queda al final
+static AVX2 void ordenarTramoCortoAvx2(int64_t *arreglo, size_t n) {
+    if (n == TRAMO_SIMD) {
+        ordenar16Avx2(arreglo);
+        return;
+    }
+    if (n < 2) {
+        return;
+    }
+    int64_t relleno[TRAMO_SIMD];
+    memcpy(relleno, arreglo, n * sizeof(int64_t));
+    for (size_t i = n; i < TRAMO_SIMD; i++) {
+        relleno[i] = INT64_MAX;
+    }
+    ordenar16Avx2(relleno);
+    memcpy(arreglo, relleno, n * sizeof(int64_t));
+}
+
+static AVX2 void ordenarTramosAvx2(int64_t *arreglo, size_t n) {
+    size_t i = 0;
+    for (; i + TRAMO_SIMD <= n; i += TRAMO_SIMD) {
+        ordenar16Avx2(arreglo + i);
+    }
+    ordenarTramoCortoAvx2(arreglo + i, n - i);
+}
+
+/*
+mezcla de a 4 elementos con la red bitonica: se guarda en un registro el bloque de
+los 4 mayores vistos y se mezcla con el siguiente bloque de la entrada cuya proxima
+clave sea menor; la cola (menos de 4 en alguna entrada) se mezcla en escalar
+*/
+static AVX2 void mezclarOrdenadosAvx2(const int64_t *a, size_t na, const int64_t *b, size_t nb,
+                                      int64_t *destino) {
+    if (na < 4 || nb < 4) {
+        mezclarOrdenadosEscalar(a, na, b, nb, destino);
+        return;
+    }
+
+    __m256i bajo = _mm256_loadu_si256((const __m256i *)a);
+    __m256i alto = _mm256_loadu_si256((const __m256i *)b);
+    size_t i = 4, j = 4, k = 0;
+    mezclar4x4(&bajo, &alto);
+    _mm256_storeu_si256((__m256i *)destino, bajo);
+    k += 4;
+
+    //lo escrito nunca alcanza a b[j]: k + 4 = i + j - 4 <= na + j - 4
+    while (i + 4 <= na && j + 4 <= nb) {
+        if (a[i] <= b[j]) {
+            bajo = _mm256_loadu_si256((const __m256i *)(a + i));
+            i += 4;
+        } else {
+            bajo = _mm256_loadu_si256((const __m256i *)(b + j));
+            j += 4;
+        }
+        mezclar4x4(&bajo, &alto);
+        _mm256_storeu_si256((__m256i *)(destino + k), bajo);
+        k += 4;
+    }
+
+    //los 4 del registro son mayores o iguales a todo lo escrito; se mezclan con
+    //lo que queda de a y de b hasta agotarlos
+    int64_t resto[4];
+    _mm256_storeu_si256((__m256i *)resto, alto);
+    size_t r = 0;
+    while (r < 4) {
+        int64_t menor = resto[r];
+        int fuente = 0;
+        if (i < na && a[i] < menor) {
+            menor = a[i];
+            fuente = 1;
+        }
+        if (j < nb && b[j] < menor) {
+            menor = b[j];
+            fuente = 2;
+        }
+        destino[k++] = menor;
+        if (fuente == 0) {
+            r++;
+        } else if (fuente == 1) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    mezclarOrdenadosEscalar(a + i, na - i, b + j, nb - j, destino + k);
+}
+
+#endif
+
+//-------------------- seleccion de kernels --------------------
+
+//elige los kernels segun la CPU y lo pedido con usarKernelsEscalares
+static void elegirKernels(void) {
+    ordenarTramosActual = ordenarTramosEscalar;
+    ordenarTramoCortoActual = ordenarTramoCortoEscalar;
+    mezclarOrdenadosActual = mezclarOrdenadosEscalar;
+    simdActivo = 0;
+#if HAY_AVX2
+    __builtin_cpu_init();
+    if (!forzarEscalares && __builtin_cpu_supports("avx2")) {
+        ordenarTramosActual = ordenarTramosAvx2;
+        ordenarTramoCortoActual = ordenarTramoCortoAvx2;
+        mezclarOrdenadosActual = mezclarOrdenadosAvx2;
+        simdActivo = 1;
+    }
+#endif
+}
+
+/*
+ordena por separado cada tramo consecutivo de TRAMO_SIMD elementos (el ultimo
+puede ser mas corto)
+arreglo: arreglo con los tramos
+n: cantidad total de elementos
+*/
+void ordenarTramos(int64_t *arreglo, size_t n) {
+    pthread_once(&kernelsElegidos, elegirKernels);
+    ordenarTramosActual(arreglo, n);
+}
+
+/*
+ordena un tramo de a lo mas TRAMO_SIMD elementos
+arreglo: tramo a ordenar
+n: cantidad de elementos (<= TRAMO_SIMD)
+*/
+void ordenarTramoCorto(int64_t *arreglo, size_t n) {
+    pthread_once(&kernelsElegidos, elegirKernels);
+    ordenarTramoCortoActual(arreglo, n);
+}
+
+/*
+mezcla dos secuencias ordenadas
+a: primera secuencia
+na: elementos de a
+b: segunda secuencia
+nb: elementos de b
+destino: donde dejar los na + nb elementos; no puede solaparse con a, y con b solo
+         si termina justo donde empieza b (destino + na == b, mezcla en el lugar)
+*/
+void mezclarOrdenados(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *destino) {
+    pthread_once(&kernelsElegidos, elegirKernels);
+    mezclarOrdenadosActual(a, na, b, nb, destino);
+}
+
+//1 si los kernels en uso son los AVX2, 0 si son los escalares
+int kernelsSimdActivos(void) {
+    pthread_once(&kernelsElegidos, elegirKernels);
+    return simdActivo;
+}
+
+/*
+fuerza los kernels escalares (para comparar) o vuelve a elegir segun la CPU;
+debe llamarse sin ordenamientos en curso
+escalares: 1 para usar siempre los escalares, 0 para usar AVX2 si la CPU lo tiene
+*/
+void usarKernelsEscalares(int escalares) {
+    pthread_once(&kernelsElegidos, elegirKernels);
+    forzarEscalares = escalares;
+    elegirKernels();
+}
@@ -0,0 +1,19 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TRAMO_SIMD 16  //elementos que ordena la red de ordenamiento en registros
+
+//kernels de ordenamiento en memoria para claves int64_t: se elige la version AVX2
+//o la escalar segun la CPU (CPUID) la primera vez que se usan
+void ordenarTramos(int64_t *arreglo, size_t n);
+void ordenarTramoCorto(int64_t *arreglo, size_t n);
+void mezclarOrdenados(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *destino);
+
+//seleccion de kernels
+int kernelsSimdActivos(void);
+void usarKernelsEscalares(int escalares);
+
+#endif